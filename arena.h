@@ -0,0 +1,213 @@
+/*
+ * arena.h
+ *
+ *  Created on: 16. 10. 2026
+ */
+
+#ifndef KISSJSON_ARENA_H_
+#define KISSJSON_ARENA_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace kjson {
+
+///Bump-pointer allocator for nodes
+/**
+ * The arena allocates nodes from large chunks. Allocation is just a pointer increment.
+ * Every chunk counts its living allocations and it is released when the last node
+ * allocated from it is destroyed and the arena no longer uses it. So the arena object itself
+ * can be destroyed anytime, the nodes can outlive it.
+ *
+ * To allocate nodes in the arena, activate it for current thread by the Scope object. While
+ * the scope is active, all new nodes are allocated from the arena
+ *
+ * @code
+ * NodeArena arena;
+ * Value v;
+ * {
+ *    NodeArena::Scope _(&arena);
+ *    v = Value::from_string(text);
+ * }
+ * @endcode
+ *
+ * @note The arena is not MT safe, it can be used by one thread at time. However, nodes can
+ * be released by any thread.
+ */
+class NodeArena {
+public:
+
+    ///Size of the chunk
+    static constexpr std::size_t chunk_size = 64*1024;
+    ///Size of the chunk when huge pages are requested
+    static constexpr std::size_t huge_chunk_size = 2*1024*1024;
+    ///All allocations are aligned to this value
+    static constexpr std::size_t alignment = 8;
+
+    ///Construct arena
+    /**
+     * @param huge_pages set true to allocate chunks of size of huge page and advise the
+     * kernel to back them by transparent huge pages (where supported)
+     */
+    explicit NodeArena(bool huge_pages = false):_huge(huge_pages) {}
+    NodeArena(const NodeArena &) = delete;
+    NodeArena &operator=(const NodeArena &) = delete;
+    ~NodeArena() {
+        retire_chunk();
+    }
+
+    ///Allocate memory
+    /**
+     * @param sz size of required memory
+     * @return pointer to memory, or nullptr, if the size is too large for the chunk (caller
+     * must use a different allocator in this case)
+     */
+    void *alloc(std::size_t sz);
+
+    ///Release memory allocated by the arena
+    /**
+     * @param ptr pointer to memory
+     * @param huge_pages must be same as huge_pages state of the arena, which allocated the memory
+     */
+    static void release(void *ptr, bool huge_pages);
+
+    ///Returns true if the arena uses huge pages
+    bool huge_pages() const {return _huge;}
+
+    ///Retrieves arena active for current thread
+    static NodeArena *current() {return current_ref();}
+
+    ///Activates arena for current thread
+    class Scope {
+    public:
+        ///Activate the arena
+        /**
+         * @param arena arena to activate. If nullptr is passed, scope does nothing (currently
+         * active arena stays active)
+         */
+        explicit Scope(NodeArena *arena):_prev(arena?current_ref():nullptr),_active(arena != nullptr) {
+            if (_active) current_ref() = arena;
+        }
+        ~Scope() {
+            if (_active) current_ref() = _prev;
+        }
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+    protected:
+        NodeArena *_prev;
+        bool _active;
+    };
+
+    ///Deactivates arena for current thread
+    /**
+     * While the object exists, new nodes are allocated by the default allocator. The
+     * previously active arena is restored on destruction
+     */
+    class Suspend {
+    public:
+        Suspend():_prev(current_ref()) {
+            current_ref() = nullptr;
+        }
+        ~Suspend() {
+            current_ref() = _prev;
+        }
+        Suspend(const Suspend &) = delete;
+        Suspend &operator=(const Suspend &) = delete;
+    protected:
+        NodeArena *_prev;
+    };
+
+    ///Retrieves count of chunks currently allocated by all arenas (for diagnostics)
+    static std::size_t chunk_count() {return chunk_counter().load(std::memory_order_relaxed);}
+
+protected:
+
+    struct Chunk {
+        std::atomic<std::size_t> refs;
+    };
+
+    ///Initial reference count, arena's own allocations are subtracted when the chunk is retired
+    static constexpr std::size_t bias = std::numeric_limits<std::size_t>::max()/2;
+    static constexpr std::size_t header_size = (sizeof(Chunk) + alignment - 1) & ~(alignment - 1);
+
+    Chunk *_chunk = nullptr;
+    char *_ptr = nullptr;
+    char *_end = nullptr;
+    std::size_t _allocs = 0;
+    bool _huge;
+
+    static NodeArena *&current_ref() {
+        static thread_local NodeArena *cur = nullptr;
+        return cur;
+    }
+
+    static std::atomic<std::size_t> &chunk_counter() {
+        static std::atomic<std::size_t> cnt = {0};
+        return cnt;
+    }
+
+    std::size_t get_chunk_size() const {return _huge?huge_chunk_size:chunk_size;}
+
+    void new_chunk();
+    void retire_chunk();
+    static void free_chunk(Chunk *chunk, bool huge_pages);
+};
+
+inline void *NodeArena::alloc(std::size_t sz) {
+    sz = (sz + alignment - 1) & ~(alignment - 1);
+    if (sz > get_chunk_size() - header_size) return nullptr;
+    if (static_cast<std::size_t>(_end - _ptr) < sz) new_chunk();
+    void *ret = _ptr;
+    _ptr += sz;
+    ++_allocs;
+    return ret;
+}
+
+inline void NodeArena::release(void *ptr, bool huge_pages) {
+    std::size_t csz = huge_pages?huge_chunk_size:chunk_size;
+    Chunk *chunk = reinterpret_cast<Chunk *>(reinterpret_cast<std::uintptr_t>(ptr) & ~(csz-1));
+    if (--chunk->refs == 0) free_chunk(chunk, huge_pages);
+}
+
+inline void NodeArena::new_chunk() {
+    retire_chunk();
+    std::size_t csz = get_chunk_size();
+    void *mem = ::operator new(csz, std::align_val_t(csz));
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (_huge) madvise(mem, csz, MADV_HUGEPAGE);
+#endif
+    ++chunk_counter();
+    _chunk = new(mem) Chunk{{bias}};
+    _ptr = reinterpret_cast<char *>(mem) + header_size;
+    _end = reinterpret_cast<char *>(mem) + csz;
+    _allocs = 0;
+}
+
+inline void NodeArena::retire_chunk() {
+    if (_chunk) {
+        std::size_t sub = bias - _allocs;
+        if (_chunk->refs.fetch_sub(sub) == sub) free_chunk(_chunk, _huge);
+        _chunk = nullptr;
+        _ptr = _end = nullptr;
+    }
+}
+
+inline void NodeArena::free_chunk(Chunk *chunk, bool huge_pages) {
+    std::size_t csz = huge_pages?huge_chunk_size:chunk_size;
+    chunk->~Chunk();
+    --chunk_counter();
+    ::operator delete(chunk, csz, std::align_val_t(csz));
+}
+
+}
+
+
+
+#endif /* KISSJSON_ARENA_H_ */
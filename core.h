@@ -10,10 +10,13 @@
 
 #include "number2str.h"
 #include "enums.h"
+#include "arena.h"
 #include <atomic>
 #include <string_view>
 #include <algorithm>
 #include <charconv>
+#include <thread>
+#include <unordered_map>
 #include "user_defined_core.h"
 
 
@@ -21,6 +24,7 @@ namespace kjson {
 
 class Node;
 class Value;
+class KeyTable;
 
 class PNode {
 public:
@@ -32,13 +36,23 @@ public:
     ~PNode();
 
     const Node *operator->() const;
-    const Node &operator *() const {return *_ptr;}
+    const Node &operator *() const {return *operator->();}
 
     bool operator==(const PNode &other) const;
     bool operator!=(const PNode &other) const;
 
+    ///Returns true, if the pointer refers a static node (which is not reference counted)
+    bool is_static() const {return (reinterpret_cast<std::uintptr_t>(_ptr) & tag_static) != 0;}
+
 protected:
+    ///Low bit of the pointer marks a static node. Such pointer is copied and
+    ///released without touching the node
+    static constexpr std::uintptr_t tag_static = 1;
+
     const Node *_ptr;
+
+    ///Returns true, if the pointer refers a node, which is reference counted
+    bool counted() const {return _ptr && !is_static();}
 };
 
 template<typename T>
@@ -58,9 +72,10 @@ struct NodeAllocator {
 
 namespace _utils {
 
+    ///Three-way comparison, returns negative number, if va < vb, positive if va > vb, or zero
     template<typename T>
     inline auto gen_compare(T va, T vb) {
-        return (va<vb?1:0) - (va>vb?1:0);
+        return (va>vb?1:0) - (va<vb?1:0);
     }
     inline auto compare_integer_string(const std::string_view &a, const std::string_view &b) {
         //empty string - could never happen, however... empty<number, number>empty, empty==empty
@@ -83,6 +98,71 @@ namespace _utils {
         return a.compare(b);
     }
 
+    ///Number text split to sign, significant digits and exponent
+    struct DecimalText {
+        ///significant digits (can contain the dot), without leading and trailing zeroes. Empty for zero
+        std::string_view digits;
+        ///decimal exponent of the first digit
+        std::int64_t exp = 0;
+        bool neg = false;
+
+        explicit DecimalText(std::string_view s) {
+            if (!s.empty() && (s[0] == '-' || s[0] == '+')) {
+                neg = s[0] == '-';
+                s = s.substr(1);
+            }
+            auto e = s.find_first_of("eE");
+            if (e != s.npos) {
+                std::string_view es = s.substr(e+1);
+                bool eneg = !es.empty() && es[0] == '-';
+                if (!es.empty() && (es[0] == '-' || es[0] == '+')) es = es.substr(1);
+                for (char c: es) {
+                    if (static_cast<unsigned char>(c - '0') >= 10) break;
+                    if (exp < 1000000000000000LL) exp = exp * 10 + (c - '0');
+                }
+                if (eneg) exp = -exp;
+                s = s.substr(0, e);
+            }
+            auto int_len = static_cast<std::int64_t>(std::min(s.find('.'), s.size()));
+            std::int64_t i = 0;
+            std::int64_t sz = static_cast<std::int64_t>(s.size());
+            while (i < sz && (s[i] == '0' || s[i] == '.')) ++i;
+            if (i == sz) return;
+            exp += i < int_len?int_len - i - 1:int_len - i;
+            while (s[sz-1] == '0' || s[sz-1] == '.') --sz;
+            digits = s.substr(i, sz - i);
+        }
+
+        int compare_magnitude(const DecimalText &other) const {
+            if (exp != other.exp) return exp < other.exp?-1:1;
+            auto ia = digits.begin(), ea = digits.end();
+            auto ib = other.digits.begin(), eb = other.digits.end();
+            while (true) {
+                if (ia != ea && *ia == '.') ++ia;
+                if (ib != eb && *ib == '.') ++ib;
+                if (ia == ea || ib == eb) return (ia != ea) - (ib != eb);
+                if (*ia != *ib) return *ia < *ib?-1:1;
+                ++ia;
+                ++ib;
+            }
+        }
+        int sign() const {
+            return digits.empty()?0:neg?-1:1;
+        }
+    };
+
+    ///Compares two numbers in text form exactly (without conversion to binary)
+    inline int compare_decimal_string(const std::string_view &a, const std::string_view &b) {
+        DecimalText da(a);
+        DecimalText db(b);
+        int sa = da.sign();
+        int sb = db.sign();
+        if (sa != sb) return sa < sb?-1:1;
+        if (sa == 0) return 0;
+        int r = da.compare_magnitude(db);
+        return da.neg?-r:r;
+    }
+
     template<typename T> inline T checkNodePtr(const PNode &nd);
 
 
@@ -169,26 +249,90 @@ protected:
         StringType _type;
     };
 
+    ///Kind of native number
+    enum class NumberKind: std::uint8_t {
+        int64,
+        uint64,
+        float64,
+        float32
+    };
+
+    ///Content of number node
+    /**
+     * The number is stored either as text (parsed numbers) or in binary form (numbers
+     * created from C++ values, flag_native). The other form is created on the first
+     * access and cached. Because the node is immutable, the cache is never invalidated
+     */
+    struct Number {
+        union {
+            mutable std::int64_t i;
+            mutable std::uint64_t u;
+            mutable double d;
+        };
+        ///text of the number (binary number renders its text to reserved space)
+        const char *text;
+        mutable std::uint32_t text_length;
+        ///state of the cached form, see cache_none, cache_busy, cache_ready
+        mutable std::atomic<std::uint8_t> cache_state;
+        mutable NumberKind kind;
+        ///NumberType of the number
+        mutable std::uint8_t type;
+
+        static constexpr std::uint8_t cache_none = 0;
+        static constexpr std::uint8_t cache_busy = 1;
+        static constexpr std::uint8_t cache_ready = 2;
+        ///space reserved for the text of binary number
+        static constexpr std::size_t text_capacity = 24;
+
+        ///Initialize number stored as text
+        void init_text(const std::string_view &txt);
+        ///Initialize number stored in binary form
+        void init_native(NumberKind k, std::uint64_t bits, char *buffer);
+        ///Creates cached form once, other threads wait until it is ready
+        template<typename Fn> void fill_cache(Fn &&fn) const;
+        ///Retrieves text of binary number (rendered on the first call)
+        std::string_view render_text() const;
+        ///Decodes text of the number to binary form (on the first call)
+        void decode_text() const;
+        template<typename T> T to_integer() const;
+        double to_double() const {
+            switch (kind) {
+                case NumberKind::int64: return static_cast<double>(i);
+                case NumberKind::uint64: return static_cast<double>(u);
+                default: return d;
+            }
+        }
+        bool is_integer() const {
+            return kind == NumberKind::int64 || kind == NumberKind::uint64;
+        }
+    };
+
     template<typename T>
     struct NodeReserveRequest { // @suppress("Miss copy constructor or assignment operator")
         std::size_t count;
         T *result = nullptr;
+        ///flags describing how the memory was allocated (set by operator new)
+        std::uint8_t alloc_flags = 0;
     };
 
     enum InitNumberT{__init_number};
+    enum InitNativeT{__init_native};
     enum InitTextT{__init_text};
     enum InitObjectT{__init_object};
     enum InitArrayT{__init_array};
+    enum InitKeyT{__init_key};
 
 
     Node(bool b, bool static_alloc)
         :_cntr(static_alloc?1:0)
         ,_type(ValueType::boolean)
+        ,_flags(static_alloc?flag_static:0)
         ,_boolValue(b) {}
 
     Node(ValueType type, bool static_alloc)
         :_cntr(static_alloc?1:0)
-        ,_type(type) {
+        ,_type(type)
+        ,_flags(static_alloc?flag_static:0) {
 
         switch (type) {
         default:
@@ -197,7 +341,9 @@ protected:
             break;
         case ValueType::string: new(&_str) String();
             break;
-        case ValueType::number: new(&_str) String{"0"};
+        case ValueType::number: new(&_num) Number;
+            _num.init_text("0");
+            _num.decode_text();
             break;
         case ValueType::object:
         case ValueType::array: new(&_container) Container{nullptr,0};
@@ -208,15 +354,46 @@ protected:
     Node(InitTextT, const std::string_view &text, bool static_alloc)
         :_cntr(static_alloc?1:0)
         ,_type(ValueType::string)
+        ,_flags(static_alloc?flag_static:0)
         ,_str{text} {}
 
     Node(InitNumberT, const std::string_view &text, bool static_alloc)
         :_cntr(static_alloc?1:0)
         ,_type(ValueType::number)
-        ,_str{text} {}
+        ,_flags(static_alloc?flag_static:0) {
+        new(&_num) Number;
+        _num.init_text(text);
+    }
+
+    ///text is not copied, owner of the text is stored in reserved space
+    Node(InitTextT, const std::string_view &text, StringType strtype, PNode &&owner, NodeReserveRequest<PNode> &res)
+        :Node(__init_text, text, false) {
+            _str._type = strtype;
+            init_owner(std::move(owner), res);
+    }
+    ///text is not copied, owner of the text is stored in reserved space
+    Node(InitNumberT, const std::string_view &text, PNode &&owner, NodeReserveRequest<PNode> &res)
+        :Node(__init_number, text, false) {
+            init_owner(std::move(owner), res);
+    }
+
+    ///number is stored in binary form, reserved space is used to render its text
+    Node(InitNativeT, NumberKind kind, std::uint64_t bits, bool static_alloc, NodeReserveRequest<char> &res)
+        :_cntr(static_alloc?1:0)
+        ,_type(ValueType::number)
+        ,_flags(res.alloc_flags | flag_native | (static_alloc?flag_static:0)) {
+        new(&_num) Number;
+        _num.init_native(kind, bits, res.result);
+    }
+
+    void init_owner(PNode &&owner, NodeReserveRequest<PNode> &res) {
+        new(res.result) PNode(std::move(owner));
+        _flags |= flag_owner | res.alloc_flags;
+    }
 
 
     void init_string(const std::string_view &text, StringType strtype, NodeReserveRequest<char> &res) {
+        _flags |= res.alloc_flags;
         auto sz = std::min(text.length(), res.count);
         std::copy(text.data(), text.data()+sz, res.result);
         new(&_str) String{std::string_view(res.result, sz), strtype};
@@ -224,13 +401,19 @@ protected:
 
     Node(InitTextT,  const std::string_view &text, StringType strtype, bool static_alloc, NodeReserveRequest<char> &res)
         :_cntr(static_alloc?1:0)
-        ,_type(ValueType::string) {
+        ,_type(ValueType::string)
+        ,_flags(static_alloc?flag_static:0) {
             init_string(text, strtype, res);
     }
     Node(InitNumberT,  const std::string_view &text, bool static_alloc, NodeReserveRequest<char> &res)
         :_cntr(static_alloc?1:0)
-        ,_type(ValueType::number) {
-            init_string(text, StringType::utf8, res);
+        ,_type(ValueType::number)
+        ,_flags(static_alloc?flag_static:0) {
+            _flags |= res.alloc_flags;
+            auto sz = std::min(text.length(), res.count);
+            std::copy(text.data(), text.data()+sz, res.result);
+            new(&_num) Number;
+            _num.init_text(std::string_view(res.result, sz));
     }
 
     ///create slice of other array or object - owner target is not container, creates empty array
@@ -245,6 +428,7 @@ protected:
 
     template<typename Fn, typename=decltype(std::declval<Fn>()(std::declval<ContBuilder &>()))>
     void init_container(Fn &&builder, NodeReserveRequest<PNode> &res) {
+        _flags |= res.alloc_flags;
         ContBuilder bld(res.result, res.count);
         builder(bld);
         new(&_container) Container(res.result, bld.count());
@@ -253,30 +437,42 @@ protected:
     template<typename Fn, typename=decltype(std::declval<Fn>()(std::declval<ContBuilder &>()))>
     Node(InitObjectT,  Fn &&builder, bool static_alloc, NodeReserveRequest<PNode> &res)
         :_cntr(static_alloc?1:0)
-        ,_type(ValueType::object) {
+        ,_type(ValueType::object)
+        ,_flags(static_alloc?flag_static:0) {
             init_container(std::forward<Fn>(builder), res);
     }
 
     template<typename Fn, typename=decltype(std::declval<Fn>()(std::declval<ContBuilder &>()))>
     Node(InitArrayT,  Fn &&fn, bool static_alloc, NodeReserveRequest<PNode> &res)
         :_cntr(static_alloc?1:0)
-        ,_type(ValueType::array) {
+        ,_type(ValueType::array)
+        ,_flags(static_alloc?flag_static:0) {
             init_container(std::forward<Fn>(fn), res);
     }
 
     Node(const std::string_view &key, PNode &&nd,  NodeReserveRequest<char> &res)
         :_cntr(0)
-        ,_type(ValueType::key) {
+        ,_type(ValueType::key)
+        ,_flags(res.alloc_flags) {
 
         auto sz = std::min(key.length(), res.count);
         std::copy(key.data(), key.data()+sz, res.result);
         new (&_keyvalue) KeyValue{std::string_view(res.result, sz), std::move(nd)};
     }
 
+    ///key is not copied, owner of the key is stored in reserved space
+    Node(InitKeyT, const std::string_view &key, PNode &&nd, PNode &&owner, NodeReserveRequest<PNode> &res)
+        :_cntr(0)
+        ,_type(ValueType::key) {
+        new (&_keyvalue) KeyValue{key, std::move(nd)};
+        init_owner(std::move(owner), res);
+    }
+
 
     Node(const UserDefinedValueTypeDesc &user_type, void *args, NodeReserveRequest<char> &res)
         :_cntr(0)
         ,_type(ValueType::user_defined)
+        ,_flags(res.alloc_flags)
         ,_userdef{user_type, res.result, res.count} {
 
             if (_userdef.type_desc.init)
@@ -291,21 +487,36 @@ protected:
     template<typename T>
     void *operator new(std::size_t sz, NodeReserveRequest<T> &req) {
         auto totalsz = sz+sizeof(T)*req.count;
-        void *p = getAllocator().alloc(totalsz);
+        void *p = nullptr;
+        NodeArena *arena = NodeArena::current();
+        if (arena) {
+            p = arena->alloc(totalsz);
+            if (p) req.alloc_flags = arena->huge_pages()?flag_arena|flag_arena_huge:flag_arena;
+        }
+        if (!p) p = getAllocator().alloc(totalsz);
         req.result = reinterpret_cast<T *>(reinterpret_cast<char *>(p)+sz);
         return p;
     }
 
     template<typename T>
     void operator delete(void *ptr, NodeReserveRequest<T> &req) {
-        getAllocator().dealloc(ptr);
+        dealloc(ptr, req.alloc_flags);
+    }
+
+    static void dealloc(void *ptr, std::uint8_t flags) {
+        if (flags & flag_arena) NodeArena::release(ptr, (flags & flag_arena_huge) != 0);
+        else getAllocator().dealloc(ptr);
     }
 
 
 public:
     ~Node() {
+        if (_flags & flag_owner) {
+            reinterpret_cast<PNode *>(this+1)->~PNode();
+        }
         switch( _type) {
-            case ValueType::number:
+            case ValueType::number: _num.~Number();
+            break;
             case ValueType::string: _str.~String();
             break;
             case ValueType::key:_keyvalue.~KeyValue();
@@ -330,6 +541,14 @@ public:
         getAllocator().dealloc(ptr);
     }
 
+    ///Destroys node and releases its memory (called when last reference is released)
+    static void destroy(const Node *nd) {
+        std::uint8_t flags = nd->_flags;
+        Node *n = const_cast<Node *>(nd);
+        n->~Node();
+        dealloc(n, flags);
+    }
+
     void *operator new(std::size_t sz) {
         return getAllocator().alloc(sz);
     }
@@ -393,14 +612,87 @@ public:
         return PNode(new(req) Node(__init_number, txt, false, req));
     }
 
-    static PNode new_number(unsigned int v) {return v?new_number(unsigned_to_string<10>(v)):shared_zero();}
-    static PNode new_number(int v) {return v?new_number(signed_to_string<10>(v)):shared_zero();}
-    static PNode new_number(unsigned long v) {return v?new_number(unsigned_to_string<10>(v)):shared_zero();}
-    static PNode new_number(long v) {return v?new_number(signed_to_string<10>(v)):shared_zero();}
-    static PNode new_number(unsigned long long v) {return v?new_number(unsigned_to_string<10>(v)):shared_zero();}
-    static PNode new_number(long long v) {return v?new_number(unsigned_to_string<10>(v)):shared_zero();}
-    static PNode new_number(float v) {return v?new_number(float_to_string(v,5)):shared_zero();}
-    static PNode new_number(double v) {return v?new_number(float_to_string(v,14)):shared_zero();}
+    ///Create string node, which references a text owned by other node (text is not copied)
+    /**
+     * @param txt text of the string
+     * @param strtype type of the string
+     * @param owner node which owns the text. The reference is held while the string node exists
+     */
+    static PNode new_string(const std::string_view &txt, StringType strtype, PNode owner) {
+        if (txt.empty()) return shared_empty_string();
+        NodeReserveRequest<PNode> req{1};
+        return PNode(new(req) Node(__init_text, txt, strtype, std::move(owner), req));
+    }
+
+    ///Create number node, which references a text owned by other node (text is not copied)
+    /**
+     * @param txt text of the number
+     * @param owner node which owns the text. The reference is held while the number node exists
+     */
+    static PNode new_number(const std::string_view &txt, PNode owner) {
+        if (txt.empty() || txt == "0") return shared_zero();
+        NodeReserveRequest<PNode> req{1};
+        return PNode(new(req) Node(__init_number, txt, std::move(owner), req));
+    }
+
+    ///Create number node which holds the number in binary form (text is rendered on demand)
+    static PNode new_native_number(NumberKind kind, std::uint64_t bits) {
+        NodeReserveRequest<char> req{Number::text_capacity};
+        return PNode(new(req) Node(__init_native, kind, bits, false, req));
+    }
+
+    ///Smallest integer served by a static node
+    static constexpr long long small_int_min = -128;
+    ///Largest integer served by a static node
+    static constexpr long long small_int_max = 1023;
+
+    ///Retrieves static node of small integer (no allocation, no reference counting)
+    /**
+     * @param v integer in range small_int_min..small_int_max
+     */
+    static PNode shared_small_int(long long v) {
+        constexpr std::size_t count = small_int_max - small_int_min + 1;
+        struct Table {
+            alignas(Node) unsigned char nodes[count][sizeof(Node)];
+            char text[count][8];
+            Table() {
+                for (std::size_t i = 0; i < count; ++i) {
+                    NodeReserveRequest<char> req{sizeof(text[i]), text[i]};
+                    long long n = small_int_min + static_cast<long long>(i);
+                    Node *nd = ::new(nodes[i]) Node(__init_native, NumberKind::int64, static_cast<std::uint64_t>(n), true, req);
+                    nd->_num.render_text();
+                }
+            }
+        };
+        static Table table;
+        return PNode(reinterpret_cast<const Node *>(table.nodes[v - small_int_min]));
+    }
+
+    static PNode new_number(unsigned int v) {return new_number(static_cast<unsigned long long>(v));}
+    static PNode new_number(int v) {return new_number(static_cast<long long>(v));}
+    static PNode new_number(unsigned long v) {return new_number(static_cast<unsigned long long>(v));}
+    static PNode new_number(long v) {return new_number(static_cast<long long>(v));}
+    static PNode new_number(unsigned long long v) {
+        if (v <= static_cast<unsigned long long>(small_int_max)) return v?shared_small_int(static_cast<long long>(v)):shared_zero();
+        return new_native_number(NumberKind::uint64, v);
+    }
+    static PNode new_number(long long v) {
+        if (v >= small_int_min && v <= small_int_max) return v?shared_small_int(v):shared_zero();
+        return new_native_number(NumberKind::int64, static_cast<std::uint64_t>(v));
+    }
+    static PNode new_number(float v) {
+        if (!v) return shared_zero();
+        double d = v;
+        std::uint64_t bits;
+        std::memcpy(&bits, &d, sizeof(bits));
+        return new_native_number(NumberKind::float32, bits);
+    }
+    static PNode new_number(double v) {
+        if (!v) return shared_zero();
+        std::uint64_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        return new_native_number(NumberKind::float64, bits);
+    }
 
     template<typename Fn, typename=decltype(std::declval<Fn>()(std::declval<ContBuilder &>()))>
     static PNode new_array(std::size_t sz, Fn &&builder) {
@@ -416,6 +708,41 @@ public:
         return PNode(new(req) Node(__init_object,std::forward<Fn>(builder),false,req));
     }
 
+    ///Create container with reserved space, which is filled later by pending_push()
+    /**
+     * Low level function, which allows to build container incrementally without
+     * intermediate storage. The container must not be shared until it is finished
+     * by pending_finish()
+     *
+     * @param type ValueType::array or ValueType::object
+     * @param capacity exact count of items
+     * @return new container
+     */
+    static PNode new_pending_container(ValueType type, std::size_t capacity) {
+        auto no_items = [](ContBuilder &) {};
+        if (type == ValueType::object) return new_object(capacity, no_items);
+        else return new_array(capacity, no_items);
+    }
+
+    ///Append item to a pending container
+    /**
+     * @param cont container created by new_pending_container()
+     * @param item item to append. Caller is responsible to not exceed the capacity
+     */
+    static void pending_push(const PNode &cont, PNode &&item) {
+        const_cast<Node &>(*cont)._container.push_back(std::move(item));
+    }
+
+    ///Finish pending container (objects are sorted)
+    static void pending_finish(const PNode &cont) {
+        if (cont->_type == ValueType::object) {
+            Container &c = const_cast<Node &>(*cont)._container;
+            if (!std::is_sorted(c.begin(), c.end(), KeyOrder())) {
+                std::sort(c.begin(), c.end(), KeyOrder());
+            }
+        }
+    }
+
     static PNode new_slice(const SliceInfo &slc) {
         return PNode(new Node(slc));
     }
@@ -425,12 +752,6 @@ public:
 
 
     PNode set_key(const std::string_view &key) const {
-
-        static auto new_key = [] (const std::string_view &key,  PNode &&target) -> PNode {
-            NodeReserveRequest<char> req{key.size()};
-            return PNode(new(req) Node(key, std::move(target), req));
-        };
-
         if (_type == ValueType::key) {
             if (_keyvalue.key == key) return this;
             return key.empty()?PNode(this):new_key(key, unset_key());
@@ -439,6 +760,34 @@ public:
         }
     }
 
+    ///Create key node
+    /**
+     * @param key key (must not be empty)
+     * @param target node to bind to the key (must not be a key node). The reference is moved
+     * @return key node
+     */
+    static PNode new_key(const std::string_view &key,  PNode &&target) {
+        NodeReserveRequest<char> req{key.size()};
+        return PNode(new(req) Node(key, std::move(target), req));
+    }
+
+    ///Create key node with interned key
+    /**
+     * @param key key (must not be empty)
+     * @param target node to bind to the key (must not be a key node). The reference is moved
+     * @param keys key table
+     * @return key node
+     */
+    static PNode new_key(const std::string_view &key,  PNode &&target, KeyTable &keys);
+
+    ///Bind key using key table (key is interned)
+    /**
+     * @param key key
+     * @param keys key table. Nodes which share the key also share its text
+     * @return new node
+     */
+    PNode set_key(const std::string_view &key, KeyTable &keys) const;
+
     PNode unset_key() const {
         return PNode (_type == ValueType::key?_keyvalue.value:this);
     }
@@ -448,19 +797,28 @@ public:
         else return std::string_view();
     }
 
+    ///Compares keys, interned keys are compared by pointer
+    static bool key_equal(const std::string_view &a, const std::string_view &b) {
+        return a.size() == b.size() && (a.data() == b.data() || a == b);
+    }
+
+    static bool key_less(const std::string_view &a, const std::string_view &b) {
+        return (a.data() != b.data() || a.size() != b.size()) && a < b;
+    }
+
     struct KeyOrder {
         bool operator()(const PNode &a, const PNode &b) const {
-            return a->get_key() < b->get_key();
+            return key_less(a->get_key(), b->get_key());
         }
         bool operator()(const PNode &a, const std::string_view &b) const {
-            return a->get_key() < b;
+            return key_less(a->get_key(), b);
         }
         bool operator()(const std::string_view &a, const PNode &b) const {
-            return a < b->get_key();
+            return key_less(a, b->get_key());
         }
     };
     static bool key_ordering_equal(const PNode &a, const PNode &b) {
-        return a->get_key() == b->get_key();
+        return key_equal(a->get_key(), b->get_key());
     }
 
     std::string_view get_string() const {
@@ -468,7 +826,7 @@ public:
         case ValueType::array: if (_container.empty()) return "[]"; else return "[...]";
         case ValueType::object: if (_container.empty()) return "{}"; else return "{...}";
         case ValueType::key: return _keyvalue.value->get_string();
-        case ValueType::number:
+        case ValueType::number: if (_flags & flag_native) return _num.render_text(); else return std::string_view(_num.text, _num.text_length);
         case ValueType::string: return _str.text;
         case ValueType::boolean: return _boolValue?"true":"false";
         case ValueType::user_defined: return _userdef.type_desc.get_string?_userdef.type_desc.get_string(_userdef):_userdef.type_desc.get_type_name();
@@ -483,7 +841,7 @@ public:
           case ValueType::array:
           case ValueType::object:return !_container.empty();
           case ValueType::key: return _keyvalue.value->get_boolean();
-          case ValueType::number: return  _str.text == "0";
+          case ValueType::number: return get_number().to_double() != 0;
           case ValueType::string: return ! _str.text.empty();
           case ValueType::boolean: return _boolValue;
           default:
@@ -493,14 +851,65 @@ public:
     }
 
 
-    unsigned int get_unsigned_int() const {return string_to_unsigned<unsigned int>(get_string());}
-    unsigned long get_unsigned_long() const {return string_to_unsigned<unsigned long>(get_string());}
-    unsigned long long get_unsigned_long_long() const {return string_to_unsigned<unsigned long long>(get_string());}
-    int get_int() const {return string_to_signed<int>(get_string());}
-    long get_long() const {return string_to_signed<long>(get_string());}
-    long long get_long_long() const {return string_to_signed<long long>(get_string());}
-    float get_float() const {return static_cast<float>(string_to_float(get_string()));}
-    double get_double() const {return string_to_float(get_string());}
+    unsigned int get_unsigned_int() const {return get_integer<unsigned int>();}
+    unsigned long get_unsigned_long() const {return get_integer<unsigned long>();}
+    unsigned long long get_unsigned_long_long() const {return get_integer<unsigned long long>();}
+    int get_int() const {return get_integer<int>();}
+    long get_long() const {return get_integer<long>();}
+    long long get_long_long() const {return get_integer<long long>();}
+    float get_float() const {return static_cast<float>(get_double());}
+    double get_double() const {
+        if (_type == ValueType::key) return _keyvalue.value->get_double();
+        if (_type == ValueType::number) return get_number().to_double();
+        return string_to_float(get_string());
+    }
+
+    ///Retrieves number as integer, result is saturated to range of the type
+    template<typename T>
+    T get_integer() const {
+        if (_type == ValueType::key) return _keyvalue.value->get_integer<T>();
+        if (_type == ValueType::number) return get_number().to_integer<T>();
+        if constexpr(std::is_signed_v<T>) return string_to_signed<T>(get_string());
+        else return string_to_unsigned<T>(get_string());
+    }
+
+    ///Retrieves number as exact fixed-point decimal
+    /**
+     * The number is converted from its text, so no precision is lost
+     *
+     * @param scale count of decimal places
+     * @return number multiplied by 10^scale. Returns no value, if the value is not a number
+     * (a string containing digits included), if the result doesn't fit to 64 bits, or if
+     * it has more decimal places than the scale
+     */
+    std::optional<std::int64_t> get_decimal(unsigned int scale) const {
+        if (get_type() != ValueType::number) return {};
+        return string_to_decimal<std::int64_t>(get_string(), scale);
+    }
+
+#ifdef __SIZEOF_INT128__
+    ///Retrieves number as exact fixed-point decimal in 128-bit integer
+    /** @see get_decimal */
+    std::optional<__int128> get_decimal128(unsigned int scale) const {
+        if (get_type() != ValueType::number) return {};
+        return string_to_decimal<__int128>(get_string(), scale);
+    }
+#endif
+
+    ///Retrieves content of number node in binary form, text is decoded on the first call
+    /**
+     * @note must be called on number node
+     */
+    const Number &get_number() const {
+        if (!(_flags & flag_native)) _num.decode_text();
+        return _num;
+    }
+
+    ///Returns true, if the number is stored in binary form
+    bool is_native_number() const {
+        if (_type == ValueType::key) return _keyvalue.value->is_native_number();
+        return _type == ValueType::number && (_flags & flag_native);
+    }
     StringType get_string_type() const {
         switch(_type) {
         case ValueType::string:
@@ -552,7 +961,7 @@ public:
             } break;
         case ValueType::object: {
                 auto iter = std::lower_bound(_container.begin(), _container.end(), key, KeyOrder());
-                return iter == _container.end() || (*iter)->get_key() != key?shared_undefined():*iter;
+                return iter == _container.end() || !key_equal((*iter)->get_key(), key)?shared_undefined():*iter;
             } break;
         case ValueType::key:
             return _keyvalue.value->get(key);
@@ -601,12 +1010,11 @@ public:
     ValueType get_type() const {return _type == ValueType::key?_keyvalue.value->get_type():_type;}
 
     NumberType get_number_type() const {
-        if (get_type() != ValueType::number) return NumberType::not_number;
-        auto s = get_string();
-        if (s.empty()) return NumberType::not_number;
-        auto n = s.find_first_of(".eE");
-        if (n != s.npos) return NumberType::real_number;
-        return (std::isdigit(s[0]))?NumberType::unsigned_number:NumberType::signed_number;
+        switch (_type) {
+            case ValueType::key: return _keyvalue.value->get_number_type();
+            case ValueType::number: return static_cast<NumberType>(get_number().type);
+            default: return NumberType::not_number;
+        }
     }
 
     int compare(const Node &other) const {
@@ -627,7 +1035,20 @@ public:
                 if (nta == NumberType::not_number || ntb == NumberType::not_number) {
                     return a->get_string().compare(b->get_string());
                 } else if (nta == NumberType::real_number || ntb == NumberType::real_number) {
-                    return _utils::gen_compare(a->get_double(), b->get_double());
+                    //rounding to double is monotonic, so different doubles give the right order.
+                    //Equal doubles of text numbers are compared exactly in decimal
+                    int r = _utils::gen_compare(a->get_double(), b->get_double());
+                    if (r || (a->is_native_number() && b->is_native_number())) return r;
+                    return _utils::compare_decimal_string(a->get_string(), b->get_string());
+                } else if (a->get_number().is_integer() && b->get_number().is_integer()) {
+                    //both are integers, negative numbers are always int64
+                    const Number &na = a->_num;
+                    const Number &nb = b->_num;
+                    bool nega = na.kind == NumberKind::int64 && na.i < 0;
+                    bool negb = nb.kind == NumberKind::int64 && nb.i < 0;
+                    if (nega != negb) return nega?-1:1;
+                    if (nega) return _utils::gen_compare(na.i, nb.i);
+                    return _utils::gen_compare(na.u, nb.u);
                 } else {
                     return _utils::compare_integer_string(a->get_string(), b->get_string());
                 }
@@ -644,9 +1065,10 @@ public:
             case ValueType::object: {
                 std::size_t cc = std::min(a->_container.size(), b->_container.size());
                 for (std::size_t i = 0; i < cc; ++i) {
-                    auto res = a->_container[i]->get_key().compare(b->_container[i]->get_key());
-                    if (res) return res;
-                    res = a->_container[i]->compare(*(b->_container[i]));
+                    auto ka = a->_container[i]->get_key();
+                    auto kb = b->_container[i]->get_key();
+                    if (!key_equal(ka, kb)) return ka.compare(kb);
+                    int res = a->_container[i]->compare(*(b->_container[i]));
                     if (res) return res;
                 }
                 return _utils::gen_compare(a->_container.size(), b->_container.size());
@@ -654,6 +1076,11 @@ public:
         }
     }
 
+    ///Returns true, if the node is static (it is never released)
+    bool is_static() const {
+        return (_flags & flag_static) != 0;
+    }
+
     void add_ref() const {
         ++_cntr;
     }
@@ -665,11 +1092,25 @@ public:
 
 
 protected:
+
+    ///node holds reference to owner of its content (PNode in reserved space)
+    static constexpr std::uint8_t flag_owner = 1;
+    ///node is allocated in an arena
+    static constexpr std::uint8_t flag_arena = 2;
+    ///node is allocated in an arena with huge pages
+    static constexpr std::uint8_t flag_arena_huge = 4;
+    ///number node is stored in binary form (text is rendered on demand)
+    static constexpr std::uint8_t flag_native = 8;
+    ///node is static, PNode doesn't count references to it
+    static constexpr std::uint8_t flag_static = 16;
+
     mutable std::atomic<unsigned long> _cntr;
     ValueType _type;
+    std::uint8_t _flags = 0;
     union {
         bool _boolValue;
         String _str;
+        Number _num;
         Container _container;
         KeyValue _keyvalue;
         UserDefinedValue _userdef;
@@ -678,11 +1119,17 @@ protected:
 
 
 inline PNode::PNode(const Node *ptr):_ptr(ptr) {
-    if (_ptr) _ptr->add_ref();
+    if (_ptr) {
+        if (_ptr->is_static()) {
+            _ptr = reinterpret_cast<const Node *>(reinterpret_cast<std::uintptr_t>(_ptr) | tag_static);
+        } else {
+            _ptr->add_ref();
+        }
+    }
 }
 
 inline PNode::PNode(const PNode &other):_ptr(other._ptr) {
-    if (_ptr) _ptr->add_ref();
+    if (counted()) _ptr->add_ref();
 }
 
 inline PNode::PNode(PNode &&other):_ptr(other._ptr) {
@@ -691,8 +1138,8 @@ inline PNode::PNode(PNode &&other):_ptr(other._ptr) {
 
 inline PNode& PNode::operator =(const PNode &other) {
     if (this != &other) {
-        if (other._ptr) other._ptr->add_ref();
-        if (_ptr && _ptr->release_ref()) delete _ptr;
+        if (other.counted()) other._ptr->add_ref();
+        if (counted() && _ptr->release_ref()) Node::destroy(_ptr);
         _ptr = other._ptr;
     }
     return *this;
@@ -700,7 +1147,7 @@ inline PNode& PNode::operator =(const PNode &other) {
 
 inline PNode& PNode::operator =(PNode &&other) {
     if (this != &other) {
-        if (_ptr && _ptr->release_ref()) delete _ptr;
+        if (counted() && _ptr->release_ref()) Node::destroy(_ptr);
         _ptr = other._ptr;
         other._ptr = nullptr;
     }
@@ -708,11 +1155,11 @@ inline PNode& PNode::operator =(PNode &&other) {
 }
 
 inline PNode::~PNode() {
-    if (_ptr && _ptr->release_ref()) delete _ptr;
+    if (counted() && _ptr->release_ref()) Node::destroy(_ptr);
 }
 
 inline const Node* PNode::operator ->() const {
-    return _ptr;
+    return reinterpret_cast<const Node *>(reinterpret_cast<std::uintptr_t>(_ptr) & ~tag_static);
 }
 
 inline bool PNode::operator ==(const PNode &other) const {
@@ -723,6 +1170,176 @@ inline bool PNode::operator !=(const PNode &other) const {
     return _ptr != other._ptr;
 }
 
+///Table of interned keys
+/**
+ * Keys bound through the table share one immutable string node, so documents which
+ * repeat same keys store every key only once. Interned keys are also compared faster,
+ * because equal keys are detected by the pointer.
+ *
+ * @note The table is not MT safe. Nodes created with the table can be used
+ * anywhere, they don't depend on the table.
+ */
+class KeyTable {
+public:
+
+    ///Retrieves interned key. Creates new entry when key doesn't exist
+    /**
+     * @param key key
+     * @return string node which contains the key
+     */
+    const PNode &intern(const std::string_view &key) {
+        auto iter = _keys.find(key);
+        if (iter == _keys.end()) {
+            PNode nd = Node::new_string(key, StringType::utf8);
+            std::string_view k = nd->get_string();
+            iter = _keys.emplace(k, std::move(nd)).first;
+        }
+        return iter->second;
+    }
+
+    ///Retrieves count of keys
+    std::size_t size() const {return _keys.size();}
+
+    ///Removes all keys from the table (nodes which use the keys are not affected)
+    void clear() {_keys.clear();}
+
+protected:
+    std::unordered_map<std::string_view, PNode> _keys;
+};
+
+inline PNode Node::set_key(const std::string_view &key, KeyTable &keys) const {
+    if (key.empty()) return PNode(this);
+    const PNode &k = keys.intern(key);
+    std::string_view txt = k->get_string();
+    if (_type == ValueType::key && _keyvalue.key.data() == txt.data()) return this;
+    NodeReserveRequest<PNode> req{1};
+    return PNode(new(req) Node(__init_key, txt, unset_key(), PNode(k), req));
+}
+
+inline PNode Node::new_key(const std::string_view &key,  PNode &&target, KeyTable &keys) {
+    const PNode &k = keys.intern(key);
+    NodeReserveRequest<PNode> req{1};
+    return PNode(new(req) Node(__init_key, k->get_string(), std::move(target), PNode(k), req));
+}
+
+inline void Node::Number::init_text(const std::string_view &txt) {
+    u = 0;
+    text = txt.data();
+    text_length = static_cast<std::uint32_t>(std::min<std::size_t>(txt.size(), std::numeric_limits<std::uint32_t>::max()));
+    cache_state.store(cache_none, std::memory_order_relaxed);
+    kind = NumberKind::int64;
+    type = static_cast<std::uint8_t>(NumberType::not_number);
+}
+
+inline void Node::Number::init_native(NumberKind k, std::uint64_t bits, char *buffer) {
+    u = bits;
+    text = buffer;
+    text_length = 0;
+    cache_state.store(cache_none, std::memory_order_relaxed);
+    kind = k;
+    NumberType t;
+    switch (k) {
+        case NumberKind::int64: t = i < 0?NumberType::signed_number:NumberType::unsigned_number; break;
+        case NumberKind::uint64: t = NumberType::unsigned_number; break;
+        default:
+            //same as the text: integers below 1e8 are rendered without dot and exponent
+            if (d == std::trunc(d) && std::abs(d) < 1e8) {
+                t = d < 0?NumberType::signed_number:NumberType::unsigned_number;
+            } else {
+                t = NumberType::real_number;
+            }
+    }
+    type = static_cast<std::uint8_t>(t);
+}
+
+template<typename Fn>
+inline void Node::Number::fill_cache(Fn &&fn) const {
+    while (true) {
+        std::uint8_t st = cache_state.load(std::memory_order_acquire);
+        if (st == cache_ready) return;
+        if (st == cache_none && cache_state.compare_exchange_strong(st, cache_busy, std::memory_order_acquire)) {
+            try {
+                fn();
+            } catch (...) {
+                //cache is not created, next reader tries again
+                cache_state.store(cache_none, std::memory_order_release);
+                throw;
+            }
+            cache_state.store(cache_ready, std::memory_order_release);
+            return;
+        }
+        //other thread is creating the cached form
+        std::this_thread::yield();
+    }
+}
+
+inline std::string_view Node::Number::render_text() const {
+    fill_cache([&]{
+        auto render = [&](std::string_view txt) {
+            txt = txt.substr(0, text_capacity);
+            std::copy(txt.begin(), txt.end(), const_cast<char *>(text));
+            text_length = static_cast<std::uint32_t>(txt.size());
+        };
+        switch (kind) {
+            case NumberKind::int64: render(signed_to_string<10>(i)); break;
+            case NumberKind::uint64: render(unsigned_to_string<10>(u)); break;
+            case NumberKind::float32: render(float_to_string(static_cast<float>(d))); break;
+            default: render(float_to_string(d)); break;
+        }
+    });
+    return std::string_view(text, text_length);
+}
+
+inline void Node::Number::decode_text() const {
+    fill_cache([&]{
+        std::string_view s(text, text_length);
+        if (s.empty()) return;
+        if (s.find_first_of(".eE") != s.npos) {
+            type = static_cast<std::uint8_t>(NumberType::real_number);
+            kind = NumberKind::float64;
+            d = string_to_float(std::string_view(s));
+            return;
+        }
+        bool neg = s[0] == '-';
+        type = static_cast<std::uint8_t>(std::isdigit(s[0])?NumberType::unsigned_number:NumberType::signed_number);
+        if (neg || s[0] == '+') s = s.substr(1);
+        std::uint64_t v;
+        bool overflow;
+        _details::parse_decimal_u64(s.data(), s.data()+s.size(), v, overflow);
+        if (overflow || (neg && v > (std::uint64_t(1) << 63))) {
+            //integer out of 64-bit range
+            kind = NumberKind::float64;
+            d = string_to_float(std::string_view(text, text_length));
+        } else if (neg) {
+            kind = NumberKind::int64;
+            u = std::uint64_t(0) - v;
+        } else {
+            kind = NumberKind::uint64;
+            u = v;
+        }
+    });
+}
+
+template<typename T>
+inline T Node::Number::to_integer() const {
+    using L = std::numeric_limits<T>;
+    switch (kind) {
+        case NumberKind::int64:
+            if (i < 0) {
+                if constexpr(L::is_signed) return i < static_cast<std::int64_t>(L::min())?L::min():static_cast<T>(i);
+                else return 0;
+            }
+            return u > static_cast<std::uint64_t>(L::max())?L::max():static_cast<T>(u);
+        case NumberKind::uint64:
+            return u > static_cast<std::uint64_t>(L::max())?L::max():static_cast<T>(u);
+        default:
+            if (!(d == d)) return 0;
+            if (d <= static_cast<double>(L::min())) return L::min();
+            if (d >= static_cast<double>(L::max())) return L::max();
+            return static_cast<T>(d);
+    }
+}
+
 inline PNode Node::new_user_value(const UserDefinedValueTypeDesc &type, void *args) {
     NodeReserveRequest<char> req;
     req.count = type.get_required_size?type.get_required_size(args):0;
@@ -0,0 +1,421 @@
+/*
+ * lazy.h
+ *
+ *  Created on: 16. 10. 2026
+ */
+
+#ifndef KISSJSON_LAZY_H_
+#define KISSJSON_LAZY_H_
+
+#include "parser.h"
+#include "structural_index.h"
+#include <mutex>
+#include <unordered_map>
+
+namespace kjson {
+
+class LazyValue;
+
+///JSON document parsed on demand
+/**
+ * The document holds the JSON text and its structural index. Nothing else is parsed
+ * in advance. Values are navigated through LazyValue objects, which only refer
+ * positions in the text. A subtree is parsed into ordinary Value when it is requested
+ * (see LazyValue::get()). Skipped siblings are never allocated, they are skipped
+ * by bracket matching over the index
+ *
+ * @code
+ * LazyDocument doc(std::move(text));
+ * auto id = doc.root()["result"]["items"][0]["id"].get_int();
+ * @endcode
+ *
+ * @note The text is not validated in advance. Errors are reported (as ParseError) when
+ * an invalid part of the document is reached
+ */
+class LazyDocument {
+public:
+
+    ///Construct document
+    /**
+     * @param text JSON text. The text is moved to the document
+     */
+    explicit LazyDocument(std::string text)
+        :_text(std::move(text)), _index(_text) {}
+
+    LazyDocument(const LazyDocument &) = delete;
+    LazyDocument &operator=(const LazyDocument &) = delete;
+
+    ///Retrieves root value
+    LazyValue root() const;
+
+    ///Retrieves text of the document
+    std::string_view text() const {return _text;}
+    ///Retrieves structural index of the document
+    const StructuralIndex &index() const {return _index;}
+
+protected:
+    friend class LazyValue;
+
+    std::string _text;
+    StructuralIndex _index;
+    ///decoded strings with escape sequences (by offset of the opening quote)
+    mutable std::unordered_map<std::uint32_t, Value> _decoded;
+    mutable std::mutex _decoded_lock;
+
+    static bool is_white(char c) {return c == ' ' || c == '\n' || c == '\r' || c == '\t';}
+    char char_at_pos(std::size_t pos_index) const;
+    std::uint32_t skip_white(std::uint32_t offset) const;
+    std::size_t next_pos(std::size_t pos_index) const;
+    LazyValue value_at(std::uint32_t offset, std::size_t pos_index) const;
+    [[noreturn]] void throw_error(ParseError::Error err, std::size_t offset) const;
+    std::string_view decode_string(std::uint32_t offset, std::string_view json) const;
+};
+
+///Reference to a value of LazyDocument
+/**
+ * The object is lightweight, it only contains position of the value in the document.
+ * It can be used while the document exists.
+ */
+class LazyValue {
+public:
+
+    class iterator;
+
+    ///Construct undefined value
+    LazyValue() = default;
+
+    ///Retrieves type of the value
+    ValueType get_type() const;
+
+    auto defined() const {return get_type() != ValueType::undefined;}
+    auto is_null() const {return get_type() == ValueType::null;}
+    auto is_object() const {return get_type() == ValueType::object;}
+    auto is_array() const {return get_type() == ValueType::array;}
+    auto is_container() const {return is_object() || is_array();}
+    auto is_string() const {return get_type() == ValueType::string;}
+    auto is_number() const {return get_type() == ValueType::number;}
+    auto is_bool() const {return get_type() == ValueType::boolean;}
+
+    ///Parses the value and returns it as ordinary Value
+    /**
+     * The result is cached in this object, so repeated calls don't parse the text again
+     */
+    const Value &get() const;
+
+    ///Retrieves string
+    /**
+     * @return string. If the string doesn't contain escape sequences, returned string refers
+     * directly to the document's text. Otherwise, the string is parsed and cached in the
+     * document. In both cases, the string is valid while the document exists
+     */
+    std::string_view get_string() const;
+
+    ///Retrieves key (for members of an object)
+    /**
+     * @return key. If the key doesn't contain escape sequences, returned string refers
+     * directly to the document's text. Otherwise, the key is parsed and cached in the
+     * document. In both cases, the key is valid while the document exists
+     */
+    std::string_view get_key() const;
+
+    auto get_int() const {return get().get_int();}
+    auto get_unsigned_int() const {return get().get_unsigned_int();}
+    auto get_long() const {return get().get_long();}
+    auto get_unsigned_long() const {return get().get_unsigned_long();}
+    auto get_long_long() const {return get().get_long_long();}
+    auto get_unsigned_long_long() const {return get().get_unsigned_long_long();}
+    auto get_float() const {return get().get_float();}
+    auto get_double() const {return get().get_double();}
+    auto get_bool() const {return get().get_bool();}
+
+    ///Retrieves JSON text of the value (without parsing)
+    std::string_view get_text() const;
+
+    ///Retrieves count of items of a container
+    /**
+     * @note Items are counted by skipping them, so the operation has linear complexity
+     */
+    std::size_t size() const;
+    bool empty() const;
+
+    ///Retrieves item of an array or an object
+    /**
+     * @param idx index
+     * @return item at the index or undefined
+     */
+    LazyValue operator[](std::size_t idx) const;
+
+    ///Retrieves member of an object
+    /**
+     * @param name name of the member
+     * @return member or undefined
+     */
+    LazyValue operator[](std::string_view name) const;
+
+    iterator begin() const;
+    iterator end() const;
+
+protected:
+    friend class LazyDocument;
+
+    const LazyDocument *_doc = nullptr;
+    ///offset of the first character
+    std::uint32_t _begin = 0;
+    ///offset after the last character
+    std::uint32_t _end = 0;
+    ///index of the first structural character at or after begin
+    std::size_t _pos = 0;
+    ///index of the first structural character after the value
+    std::size_t _next = 0;
+    ///index of the opening quote of the key (object members only)
+    std::size_t _key_pos = 0;
+    ///true if the value is member of an object
+    bool _has_key = false;
+    mutable Value _cache;
+
+    LazyValue item_after(std::size_t sep_pos) const;
+    LazyValue next_item(std::size_t sep_pos) const;
+    bool string_has_escapes(std::size_t quote_pos) const;
+};
+
+///Iterates items of a container
+class LazyValue::iterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = LazyValue;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const LazyValue *;
+    using reference = const LazyValue &;
+
+    iterator() = default;
+    explicit iterator(LazyValue v):_cur(std::move(v)) {}
+
+    reference operator *() const {return _cur;}
+    pointer operator ->() const {return &_cur;}
+    iterator &operator++() {_cur = _cur.next_item(_cur._next); return *this;}
+    iterator operator++(int) {iterator tmp = *this; operator++(); return tmp;}
+
+    bool operator == (const iterator &other) const {
+        return _cur._doc == other._cur._doc && _cur._begin == other._cur._begin;
+    }
+    bool operator != (const iterator &other) const {return !operator==(other);}
+
+protected:
+    LazyValue _cur;
+};
+
+inline char LazyDocument::char_at_pos(std::size_t pos_index) const {
+    if (pos_index >= _index.size()) throw_error(ParseError::Error::unexpected_end_of_file, _text.size());
+    return _text[_index.positions()[pos_index]];
+}
+
+inline std::uint32_t LazyDocument::skip_white(std::uint32_t offset) const {
+    while (offset < _text.size() && is_white(_text[offset])) ++offset;
+    if (offset >= _text.size()) throw_error(ParseError::Error::unexpected_end_of_file, _text.size());
+    return offset;
+}
+
+inline std::size_t LazyDocument::next_pos(std::size_t pos_index) const {
+    ++pos_index;
+    char_at_pos(pos_index);
+    return pos_index;
+}
+
+inline void LazyDocument::throw_error(ParseError::Error err, std::size_t offset) const {
+    std::size_t line = 0;
+    std::size_t begline = 0;
+    for (std::size_t i = 0; i < offset && i < _text.size(); ++i) {
+        if (_text[i] == '\n') {
+            ++line;
+            begline = i+1;
+        }
+    }
+    throw ParseError(err, offset, line+1, offset - begline);
+}
+
+inline std::string_view LazyDocument::decode_string(std::uint32_t offset, std::string_view json) const {
+    std::lock_guard _(_decoded_lock);
+    auto iter = _decoded.find(offset);
+    if (iter == _decoded.end()) iter = _decoded.emplace(offset, Parser::parse_string(json)).first;
+    return iter->second.get_string();
+}
+
+inline LazyValue LazyDocument::value_at(std::uint32_t offset, std::size_t pos_index) const {
+    const auto &pos = _index.positions();
+    LazyValue r;
+    r._doc = this;
+    r._begin = offset;
+    r._pos = pos_index;
+    switch (_text[offset]) {
+        case '{':
+        case '[': {
+            if (pos_index >= pos.size() || pos[pos_index] != offset) throw_error(ParseError::Error::unexpected_character, offset);
+            //skip nested containers by counting brackets
+            int depth = 0;
+            do {
+                switch (char_at_pos(pos_index)) {
+                    case '{':
+                    case '[': ++depth; break;
+                    case '}':
+                    case ']': --depth; break;
+                    default: break;
+                }
+                ++pos_index;
+            } while (depth);
+            r._end = pos[pos_index-1]+1;
+            r._next = pos_index;
+        } break;
+        case '"': {
+            if (pos_index >= pos.size() || pos[pos_index] != offset) throw_error(ParseError::Error::unexpected_character, offset);
+            do pos_index = next_pos(pos_index); while (char_at_pos(pos_index) != '"');
+            r._end = pos[pos_index]+1;
+            r._next = pos_index+1;
+        } break;
+        default: {
+            std::uint32_t e = pos_index < pos.size()?pos[pos_index]:static_cast<std::uint32_t>(_text.size());
+            while (e > offset && is_white(_text[e-1])) --e;
+            if (e == offset) throw_error(ParseError::Error::unexpected_character, offset);
+            r._end = e;
+            r._next = pos_index;
+        } break;
+    }
+    return r;
+}
+
+inline LazyValue LazyDocument::root() const {
+    std::uint32_t b = skip_white(0);
+    return value_at(b, 0);
+}
+
+inline ValueType LazyValue::get_type() const {
+    if (!_doc) return ValueType::undefined;
+    switch (_doc->_text[_begin]) {
+        case '{': return ValueType::object;
+        case '[': return ValueType::array;
+        case '"': return ValueType::string;
+        case 't':
+        case 'f': return ValueType::boolean;
+        case 'n': return ValueType::null;
+        case 'u': return ValueType::undefined;
+        default: return ValueType::number;
+    }
+}
+
+inline std::string_view LazyValue::get_text() const {
+    if (!_doc) return std::string_view();
+    return std::string_view(_doc->_text).substr(_begin, _end - _begin);
+}
+
+inline const Value &LazyValue::get() const {
+    if (_doc && !_cache.defined()) {
+        _cache = Parser::parse_string(get_text());
+    }
+    return _cache;
+}
+
+inline bool LazyValue::string_has_escapes(std::size_t quote_pos) const {
+    //any structural character between quotes is backslash or control character
+    return _doc->char_at_pos(quote_pos+1) != '"';
+}
+
+inline std::string_view LazyValue::get_string() const {
+    switch (get_type()) {
+        case ValueType::string:
+            if (string_has_escapes(_pos)) return _doc->decode_string(_begin, get_text());
+            return std::string_view(_doc->_text).substr(_begin+1, _end - _begin - 2);
+        //text of the number is kept by the parser as is
+        case ValueType::number: return get_text();
+        //other types return static strings
+        default: return get().get_string();
+    }
+}
+
+inline std::string_view LazyValue::get_key() const {
+    if (!_has_key) return std::string_view();
+    const auto &pos = _doc->_index.positions();
+    std::size_t b = pos[_key_pos];
+    if (string_has_escapes(_key_pos)) {
+        std::size_t p = _key_pos;
+        do p = _doc->next_pos(p); while (_doc->char_at_pos(p) != '"');
+        std::size_t e = pos[p]+1;
+        return _doc->decode_string(static_cast<std::uint32_t>(b), std::string_view(_doc->_text).substr(b, e - b));
+    }
+    return std::string_view(_doc->_text).substr(b+1, pos[_key_pos+1] - b - 1);
+}
+
+inline LazyValue LazyValue::item_after(std::size_t sep_pos) const {
+    const LazyDocument &doc = *_doc;
+    const auto &pos = doc._index.positions();
+    char sep = doc.char_at_pos(sep_pos);
+    if (sep != '{' && sep != '[' && sep != ',') return LazyValue();
+    std::uint32_t b = doc.skip_white(pos[sep_pos]+1);
+    std::size_t p = doc.next_pos(sep_pos);
+    if (pos[p] == b && (doc._text[b] == '}' || doc._text[b] == ']')) {
+        if (sep == ',') doc.throw_error(ParseError::Error::unexpected_character, b);
+        return LazyValue();
+    }
+    if (sep == ',') {
+        //find out, whether this is an array or an object - it is known from the key
+        sep = _has_key?'{':'[';
+    }
+    if (sep == '[') {
+        return doc.value_at(b, p);
+    }
+    if (doc._text[b] != '"' || pos[p] != b) doc.throw_error(ParseError::Error::expected_begin_of_string, b);
+    std::size_t key_pos = p;
+    do p = doc.next_pos(p); while (doc.char_at_pos(p) != '"');
+    p = doc.next_pos(p);
+    if (doc.char_at_pos(p) != ':') doc.throw_error(ParseError::Error::expected_colon, pos[p]);
+    LazyValue r = doc.value_at(doc.skip_white(pos[p]+1), p+1);
+    r._key_pos = key_pos;
+    r._has_key = true;
+    return r;
+}
+
+inline LazyValue LazyValue::next_item(std::size_t sep_pos) const {
+    LazyValue r = item_after(sep_pos);
+    //same as the parser, objects drop members with value 'undefined'
+    while (r._has_key && r.get_type() == ValueType::undefined) r = r.item_after(r._next);
+    return r;
+}
+
+inline LazyValue::iterator LazyValue::begin() const {
+    if (!is_container()) return end();
+    return iterator(next_item(_pos));
+}
+
+inline LazyValue::iterator LazyValue::end() const {
+    return iterator();
+}
+
+inline bool LazyValue::empty() const {
+    return begin() == end();
+}
+
+inline std::size_t LazyValue::size() const {
+    std::size_t cnt = 0;
+    for (auto iter = begin(), e = end(); iter != e; ++iter) ++cnt;
+    return cnt;
+}
+
+inline LazyValue LazyValue::operator[](std::size_t idx) const {
+    for (auto iter = begin(), e = end(); iter != e; ++iter) {
+        if (idx == 0) return *iter;
+        --idx;
+    }
+    return LazyValue();
+}
+
+inline LazyValue LazyValue::operator[](std::string_view name) const {
+    if (!is_object()) return LazyValue();
+    for (auto iter = begin(), e = end(); iter != e; ++iter) {
+        if (iter->get_key() == name) return *iter;
+    }
+    return LazyValue();
+}
+
+}
+
+
+
+#endif /* KISSJSON_LAZY_H_ */
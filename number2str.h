@@ -17,20 +17,26 @@
  * main functions are
  * - unsigned_to_string
  * - signed_to_string
- * - float_to_string
+ * - float_to_string (shortest round-trip representation, Schubfach algorithm)
  * - string_to_unsigned
  * - string_to_signed
- * - string_to_float
+ * - string_to_float (correctly rounded, Clinger and Eisel-Lemire algorithms)
+ * - string_to_decimal (exact fixed-point value)
  *
  */
 
 #ifndef _KISSJSON_ONDRA_SHARED_TOSTRING_H_39289204239042_
 #define _KISSJSON_ONDRA_SHARED_TOSTRING_H_39289204239042_
 
+#include "pow10_table.h"
+#include <cfloat>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
 #include <locale>
+#include <optional>
 #include <string_view>
+#include <vector>
 
 namespace kjson {
 
@@ -51,14 +57,40 @@ void unsignedToString(const Number &n, Fn &&fn, int base=10, int leftZeroes=1) {
 template<typename Number, typename Fn>
 void signedToString(const Number &n, Fn &&fn, int base=10, int leftZeroes=1) {
 
+     using UNumber = std::make_unsigned_t<Number>;
      if (n < 0) {
           fn('-');
-          unsignedToString(-n,fn,base,leftZeroes);
+          unsignedToString(static_cast<UNumber>(UNumber(0) - static_cast<UNumber>(n)),fn,base,leftZeroes);
      } else {
-          unsignedToString(n,fn,base,leftZeroes);
+          unsignedToString(static_cast<UNumber>(n),fn,base,leftZeroes);
      }
 }
 
+///Pairs of decimal digits 00-99
+static constexpr char digit_pairs[201] = "00010203040506070809101112131415161718192021222324252627282930313233343536373839404142434445464748495051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+///Writes decimal number, two digits at time
+/**
+ * @param v number
+ * @param end end of buffer, the buffer must have space for 20 characters
+ * @return pointer to first character
+ */
+inline char *write_decimal(std::uint64_t v, char *end) {
+    while (v >= 100) {
+        auto r = static_cast<unsigned int>(v % 100);
+        v /= 100;
+        end -= 2;
+        std::memcpy(end, digit_pairs + r * 2, 2);
+    }
+    if (v >= 10) {
+        end -= 2;
+        std::memcpy(end, digit_pairs + v * 2, 2);
+    } else {
+        *--end = static_cast<char>('0' + v);
+    }
+    return end;
+}
+
 
 
 template<std::size_t bsize> struct FracMultTable;
@@ -220,6 +252,261 @@ void floatToString(Number value, Fn &&fn, int maxPrecisionDigits=14) {
     //all done
 }
 
+///Multiplies two 64-bit numbers, returns high and low part of the result
+inline std::uint64_t mul128(std::uint64_t a, std::uint64_t b, std::uint64_t &low) {
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+    low = static_cast<std::uint64_t>(r);
+    return static_cast<std::uint64_t>(r >> 64);
+#else
+    std::uint64_t a0 = a & 0xFFFFFFFF, a1 = a >> 32;
+    std::uint64_t b0 = b & 0xFFFFFFFF, b1 = b >> 32;
+    std::uint64_t p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+    std::uint64_t mid = (p00 >> 32) + (p01 & 0xFFFFFFFF) + (p10 & 0xFFFFFFFF);
+    low = (mid << 32) | (p00 & 0xFFFFFFFF);
+    return p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+#endif
+}
+
+///Decimal floating point number: digits * 10^exponent
+struct DecimalFP {
+    std::uint64_t digits;
+    int exponent;
+};
+
+///Converts binary floating point number to shortest decimal, which rounds back to same number
+/**
+ * Implementation of the Schubfach algorithm (R. Giulietti: The Schubfach way to render
+ * doubles). It needs only integer arithmetic and one table lookup. The value is c*2^q
+ *
+ * @param c significand (including hidden bit), must not be zero
+ * @param q binary exponent
+ * @param precision count of bits of significand (including hidden bit)
+ * @param lower_closer true, if the lower neighbor is closer (c is power of two and the
+ * number is normal)
+ * @return shortest decimal, when there are more shortest decimals, the closest is returned.
+ * Digits can contain trailing zeroes
+ */
+inline DecimalFP to_shortest_decimal(std::uint64_t c, int q, int precision, bool lower_closer) {
+    //small integers
+    if (q <= 0 && -q < precision && (c & ((std::uint64_t(1) << -q) - 1)) == 0) {
+        return {c >> -q, 0};
+    }
+    //floor(log10(2^q)) or floor(log10(3/4*2^q))
+    int k = (q * 1262611 - (lower_closer?524031:0)) >> 22;
+    //q + floor(log2(10^-k)) + 1
+    int h = q + ((-k * 1741647) >> 19) + 1;
+    //g = floor(10^-k*2^r)+1
+    std::uint64_t g1 = Pow10Table::high(-k);
+    std::uint64_t g0 = Pow10Table::low(-k) + 1;
+    if (g0 == 0) ++g1;
+
+    auto round_to_odd = [&](std::uint64_t cp) {
+        std::uint64_t x0, y0;
+        std::uint64_t x1 = mul128(g0, cp, x0);
+        std::uint64_t y1 = mul128(g1, cp, y0);
+        std::uint64_t z = y0 + x1;
+        y1 += z < x1;
+        return y1 | (z > 1);
+    };
+
+    bool even = (c & 1) == 0;
+    std::uint64_t vbl = round_to_odd(((c << 2) - 2 + lower_closer) << h);
+    std::uint64_t vb = round_to_odd((c << 2) << h);
+    std::uint64_t vbr = round_to_odd(((c << 2) + 2) << h);
+    std::uint64_t lower = vbl + !even;
+    std::uint64_t upper = vbr - !even;
+
+    std::uint64_t s = vb >> 2;
+    if (s >= 10) {
+        //try one digit less
+        std::uint64_t sp = s / 10;
+        bool up_inside = lower <= 40 * sp;
+        bool wp_inside = 40 * sp + 40 <= upper;
+        if (up_inside != wp_inside) return {sp + wp_inside, k + 1};
+    }
+    bool u_inside = lower <= 4 * s;
+    bool w_inside = 4 * s + 4 <= upper;
+    if (u_inside != w_inside) return {s + w_inside, k};
+    //both candidates are inside, choose closer one (ties to even)
+    std::uint64_t mid = 4 * s + 2;
+    bool round_up = vb > mid || (vb == mid && (s & 1) != 0);
+    return {s + round_up, k};
+}
+
+///Decomposes IEEE binary floating point number
+/**
+ * @param value value, must be finite and not zero
+ * @return shortest decimal representation of absolute value (without trailing zeroes)
+ */
+template<typename Number>
+DecimalFP to_shortest_decimal(Number value) {
+    static_assert(std::numeric_limits<Number>::is_iec559 && (sizeof(Number) == 8 || sizeof(Number) == 4));
+    using Bits = std::conditional_t<sizeof(Number) == 8, std::uint64_t, std::uint32_t>;
+    constexpr int precision = std::numeric_limits<Number>::digits;
+    constexpr int bias = std::numeric_limits<Number>::max_exponent - 2 + precision;
+    constexpr Bits significand_mask = (Bits(1) << (precision-1)) - 1;
+    Bits bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    Bits significand = bits & significand_mask;
+    int exponent = static_cast<int>((bits >> (precision-1)) & ((Bits(1) << (sizeof(Bits)*8 - precision)) - 1));
+    DecimalFP r;
+    if (exponent) {
+        r = to_shortest_decimal(significand | (significand_mask+1), exponent - bias, precision, significand == 0 && exponent > 1);
+    } else {
+        r = to_shortest_decimal(significand, 1 - bias, precision, false);
+    }
+    while (r.digits % 10 == 0) {
+        r.digits /= 10;
+        ++r.exponent;
+    }
+    return r;
+}
+
+///Writes shortest representation of the number
+/**
+ * Numbers with decimal exponent between -3 and 8 (exclusive) are written without the exponent
+ */
+template<typename Number, typename Fn>
+void floatToShortestString(Number value, Fn &&fn) {
+    if (value == 0) {
+        fn('0');
+        return;
+    }
+    if (!std::isfinite(value)) {
+        if (value < 0) fn('-');
+        for (const char *z = "9e9999"; *z; ++z) fn(*z);
+        return;
+    }
+    if (value < 0) {
+        fn('-');
+        value = -value;
+    }
+    DecimalFP d = to_shortest_decimal(value);
+    char buff[20];
+    const char *digits = write_decimal(d.digits, buff+20);
+    const char *end = buff+20;
+    //decimal exponent of the first digit
+    int sci = d.exponent + static_cast<int>(end - digits) - 1;
+    if (sci > -3 && sci < 8) {
+        if (d.exponent >= 0) {
+            while (digits != end) fn(*digits++);
+            for (int i = 0; i < d.exponent; ++i) fn('0');
+        } else if (sci >= 0) {
+            for (int i = 0; i <= sci; ++i) fn(*digits++);
+            fn('.');
+            while (digits != end) fn(*digits++);
+        } else {
+            fn('0');
+            fn('.');
+            for (int i = -1; i > sci; --i) fn('0');
+            while (digits != end) fn(*digits++);
+        }
+    } else {
+        fn(*digits++);
+        if (digits != end) {
+            fn('.');
+            while (digits != end) fn(*digits++);
+        }
+        fn('e');
+        if (sci > 0) fn('+');
+        signedToString(sci, fn, 10);
+    }
+}
+
+///Returns true, if 8 bytes (little endian) contain only decimal digits
+inline bool is_eight_digits(std::uint64_t v) {
+    return (((v + 0x4646464646464646ULL) | (v - 0x3030303030303030ULL)) & 0x8080808080808080ULL) == 0;
+}
+
+///Converts 8 decimal digits (little endian, first digit at lowest byte) to number
+inline std::uint32_t parse_eight_digits(std::uint64_t v) {
+    v = (v & 0x0F0F0F0F0F0F0F0FULL) * 2561 >> 8;
+    v = (v & 0x00FF00FF00FF00FFULL) * 6553601 >> 16;
+    return static_cast<std::uint32_t>((v & 0x0000FFFF0000FFFFULL) * 42949672960001ULL >> 32);
+}
+
+///Parses decimal digits to 64-bit number
+/**
+ * Digits are processed 8 at time. If the number doesn't fit to 64 bits, result
+ * is saturated
+ *
+ * @param iter begin of text
+ * @param end end of text
+ * @param out result
+ * @param overflow set to true, if the number is too large
+ * @return pointer to first character, which is not a digit
+ */
+inline const char *parse_decimal_u64(const char *iter, const char *end, std::uint64_t &out, bool &overflow) {
+    while (iter != end && *iter == '0') ++iter;
+    const char *start = iter;
+    std::uint64_t v = 0;
+    //19 digits always fit
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    while (end - iter >= 8 && iter - start <= 11) {
+        std::uint64_t x;
+        std::memcpy(&x, iter, 8);
+        if (!is_eight_digits(x)) break;
+        v = v * 100000000 + parse_eight_digits(x);
+        iter += 8;
+    }
+#endif
+    while (iter != end && iter - start < 19 && static_cast<unsigned char>(*iter - '0') < 10) {
+        v = v * 10 + static_cast<unsigned int>(*iter - '0');
+        ++iter;
+    }
+    overflow = false;
+    while (iter != end && static_cast<unsigned char>(*iter - '0') < 10) {
+        if (!overflow) {
+            std::uint64_t d = static_cast<unsigned int>(*iter - '0');
+            if (v > (std::numeric_limits<std::uint64_t>::max() - d) / 10) {
+                overflow = true;
+                v = std::numeric_limits<std::uint64_t>::max();
+            } else {
+                v = v * 10 + d;
+            }
+        }
+        ++iter;
+    }
+    out = v;
+    return iter;
+}
+
+///Parses decimal unsigned number, result is saturated to range of T
+template<typename T>
+T decimalToUnsigned(std::string_view &s) {
+    std::uint64_t v;
+    bool overflow;
+    const char *e = parse_decimal_u64(s.data(), s.data()+s.size(), v, overflow);
+    s = s.substr(e - s.data());
+    if (overflow || v > static_cast<std::uint64_t>(std::numeric_limits<T>::max())) {
+        return std::numeric_limits<T>::max();
+    }
+    return static_cast<T>(v);
+}
+
+///Parses decimal signed number, result is saturated to range of T
+template<typename T>
+T decimalToSigned(std::string_view &s) {
+    bool neg = false;
+    if (!s.empty() && (s[0] == '-' || s[0] == '+')) {
+        neg = s[0] == '-';
+        s = s.substr(1);
+    }
+    std::uint64_t v;
+    bool overflow;
+    const char *e = parse_decimal_u64(s.data(), s.data()+s.size(), v, overflow);
+    s = s.substr(e - s.data());
+    auto max = static_cast<std::uint64_t>(std::numeric_limits<T>::max());
+    if (neg) {
+        if (overflow || v > max + 1) return std::numeric_limits<T>::min();
+        return static_cast<T>(std::uint64_t(0) - v);
+    } else {
+        if (overflow || v > max) return std::numeric_limits<T>::max();
+        return static_cast<T>(v);
+    }
+}
+
 template<typename T>
 T stringToUnsigned(std::string_view &&s, int base=10) {
     T ret = 0;
@@ -271,92 +558,285 @@ T stringToSigned(std::string_view &&s, int base=10) {
 }
 
 
-template<typename Fn>
-inline double parseDoubleNumber(Fn &&fn) {
-    //parsing double is done straightforward
-    //number is separated to parts [<sign>]<int>[.<decimals>][E[<sign>]<exponent>]
-    //all numbers are integers
-
-    //read signature - if none, default is false as positive number
-    bool isneg = false;
+///Accumulates run of decimal digits to the number (overflow is ignored)
+inline const char *accumulate_digits(const char *iter, const char *end, std::uint64_t &n) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    while (end - iter >= 8) {
+        std::uint64_t v;
+        std::memcpy(&v, iter, 8);
+        if (!is_eight_digits(v)) break;
+        n = n * 100000000 + parse_eight_digits(v);
+        iter += 8;
+    }
+#endif
+    while (iter != end && static_cast<unsigned char>(*iter - '0') < 10) {
+        n = n * 10 + static_cast<unsigned>(*iter - '0');
+        ++iter;
+    }
+    return iter;
+}
 
-    //read first character, could be sign
-    int c = fn();
+///Decimal number split to parts
+struct ParsedDecimal {
+    ///first 19 significant digits
+    std::uint64_t mantissa = 0;
+    ///decimal exponent of the mantissa
+    std::int64_t exponent = 0;
+    ///true if number is negative
+    bool negative = false;
+    ///true if there are more than 19 significant digits
+    bool truncated = false;
+    ///digits of integer part
+    std::string_view int_part;
+    ///digits of fractional part
+    std::string_view frac_part;
+    ///value of exponent (saturated)
+    std::int64_t exp_part = 0;
+};
 
-    if (c == '-') { //sign = -, is negative
-        isneg = true;
-        c = fn(); // and read next
-    } else if (c == '+') { //sign = + is positive
-        c = fn(); //just read next
+///Parses decimal number [+-]digits[.digits][(e|E)[+-]digits]
+/**
+ * @param iter begin of text
+ * @param end end of text
+ * @param out parsed number
+ * @return pointer to first unprocessed character, nullptr if there is no number
+ */
+inline const char *parseDecimal(const char *iter, const char *end, ParsedDecimal &out) {
+    if (iter != end && (*iter == '-' || *iter == '+')) {
+        out.negative = *iter == '-';
+        ++iter;
     }
-
-    //no digits is error
-    if (!std::isdigit(c)) {
-        return 0;
+    const char *int_begin = iter;
+    std::uint64_t m = 0;
+    iter = accumulate_digits(iter, end, m);
+    if (iter == int_begin) return nullptr;
+    out.int_part = std::string_view(int_begin, iter - int_begin);
+    if (iter != end && *iter == '.' && iter + 1 != end && static_cast<unsigned char>(iter[1] - '0') < 10) {
+        const char *frac_begin = ++iter;
+        iter = accumulate_digits(iter, end, m);
+        out.frac_part = std::string_view(frac_begin, iter - frac_begin);
     }
-
-    //d1 contains our double number, starting at zero
-    double d1 = 0;
-    //d2 contains decimal part, starting at zero
-    double d2 = 0;
-    //contains d1 exponent
-    int d1_exponent = 0;
-    //contains d2 exponent
-    int d2_exponent = 0;
-
-    //for digits multiply current number by ten and add number
-    while (std::isdigit(c)) {
-        d1 = d1 * 10 + (c - '0');
-        c = fn();
-    }
-    //round to nearest integer
-    d1 = std::round(d1);
-    //we stop on dot, decimals follows
-    if (c == '.') {
-
-        //decimals are stored as d2*10^d2_exponent where d2 is integer stored in double
-        c = fn();
-
-        if (std::isdigit(c)) {
-            while (std::isdigit(c)) {
-                --d2_exponent;
-                d2 = d2 * 10 + (c-'0');
-                c = fn();
+    if (iter != end && (*iter == 'e' || *iter == 'E')) {
+        const char *e = iter + 1;
+        bool neg = false;
+        if (e != end && (*e == '-' || *e == '+')) {
+            neg = *e == '-';
+            ++e;
+        }
+        if (e != end && static_cast<unsigned char>(*e - '0') < 10) {
+            std::int64_t x = 0;
+            while (e != end && static_cast<unsigned char>(*e - '0') < 10) {
+                if (x < 0x10000000) x = x * 10 + (*e - '0');
+                ++e;
             }
-            //strip any decimal numbers made because rounding errors
-            d2 = std::round(d2);
-        } else {
-            return d1;
+            out.exp_part = neg?-x:x;
+            iter = e;
+        }
+    }
+    out.exponent = out.exp_part - static_cast<std::int64_t>(out.frac_part.size());
+    std::size_t digits = out.int_part.size() + out.frac_part.size();
+    if (digits > 19) {
+        //count significant digits and recalculate the mantissa, if there are too many
+        std::size_t lz = 0;
+        while (lz < out.int_part.size() && out.int_part[lz] == '0') ++lz;
+        if (lz == out.int_part.size()) {
+            std::size_t fz = 0;
+            while (fz < out.frac_part.size() && out.frac_part[fz] == '0') ++fz;
+            lz += fz;
         }
+        if (digits - lz > 19) {
+            out.truncated = true;
+            m = 0;
+            std::size_t cnt = 0;
+            std::size_t pos = lz;
+            for (; cnt < 19; ++pos, ++cnt) {
+                char c = pos < out.int_part.size()?out.int_part[pos]:out.frac_part[pos - out.int_part.size()];
+                m = m * 10 + static_cast<unsigned>(c - '0');
+            }
+            out.exponent += static_cast<std::int64_t>(digits - pos);
+        }
+    }
+    out.mantissa = m;
+    return iter;
+}
 
+///Eisel-Lemire algorithm
+/**
+ * Computes correctly rounded double for w*10^q, using 128-bit approximation of
+ * the power of ten
+ *
+ * @param w mantissa, must not be zero
+ * @param q exponent, must be in range of Pow10Table and not above 308
+ * @return bits of resulting double (positive)
+ */
+inline std::uint64_t eisel_lemire(std::uint64_t w, int q) {
+    constexpr int mantissa_bits = 52;
+    int lz = 0;
+    while ((w & (std::uint64_t(1) << 63)) == 0) {w <<= 1; ++lz;}
+    std::uint64_t hi = Pow10Table::high(q);
+    std::uint64_t lo = Pow10Table::low(q);
+    //reciprocals of small powers of 5 must be rounded up
+    if (q < 0 && q >= -27 && ++lo == 0) ++hi;
+    std::uint64_t plo;
+    std::uint64_t phi = mul128(w, hi, plo);
+    if ((phi & 0x1FF) == 0x1FF) {
+        std::uint64_t slo;
+        std::uint64_t shi = mul128(w, lo, slo);
+        plo += shi;
+        if (shi > plo) ++phi;
+    }
+    int upperbit = static_cast<int>(phi >> 63);
+    int shift = upperbit + 64 - mantissa_bits - 3;
+    std::uint64_t mantissa = phi >> shift;
+    //floor(log2(10^q)) + 63 + 1023
+    int power2 = (((152170 + 65536) * q) >> 16) + 63 + upperbit - lz + 1023;
+    if (power2 <= 0) {
+        //subnormal
+        if (-power2 + 1 >= 64) return 0;
+        mantissa >>= -power2 + 1;
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        power2 = mantissa < (std::uint64_t(1) << mantissa_bits)?0:1;
+        return (static_cast<std::uint64_t>(power2) << mantissa_bits) | mantissa;
+    }
+    //exactly between two numbers, round to even
+    if (plo <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 && (mantissa << shift) == phi) {
+        mantissa &= ~std::uint64_t(1);
+    }
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if (mantissa >= (std::uint64_t(2) << mantissa_bits)) {
+        mantissa = std::uint64_t(1) << mantissa_bits;
+        ++power2;
     }
-    if (c == 'E' || c == 'e') {
+    mantissa &= ~(std::uint64_t(1) << mantissa_bits);
+    if (power2 >= 0x7FF) return std::uint64_t(0x7FF) << mantissa_bits;
+    return (static_cast<std::uint64_t>(power2) << mantissa_bits) | mantissa;
+}
 
-        bool negexp = false;
-        c = fn();
-        if (c == '-') {
-            negexp = true;
-            c = fn();
-        } else if (c == '+') {
-            c = fn();
+///Simple arbitrary precision unsigned integer for exact comparisons
+class BigUInt {
+public:
+    explicit BigUInt(std::uint64_t v) {
+        while (v) {
+            _limbs.push_back(static_cast<std::uint32_t>(v));
+            v >>= 32;
+        }
+    }
+    void mul_add(std::uint32_t m, std::uint32_t a) {
+        std::uint64_t carry = a;
+        for (auto &l: _limbs) {
+            std::uint64_t x = static_cast<std::uint64_t>(l) * m + carry;
+            l = static_cast<std::uint32_t>(x);
+            carry = x >> 32;
         }
-        if (std::isdigit(c)) {
-            while (std::isdigit(c)) {
-                d1_exponent = d1_exponent * 10 +(c - '0');
-                c = fn();
+        if (carry) _limbs.push_back(static_cast<std::uint32_t>(carry));
+    }
+    void mul_pow5(std::int64_t e) {
+        for (; e >= 13; e -= 13) mul_add(1220703125, 0);
+        std::uint32_t m = 1;
+        while (e-- > 0) m *= 5;
+        mul_add(m, 0);
+    }
+    void shl(std::int64_t bits) {
+        if (_limbs.empty()) return;
+        _limbs.insert(_limbs.begin(), static_cast<std::size_t>(bits / 32), 0);
+        unsigned int b = static_cast<unsigned int>(bits % 32);
+        if (b) {
+            std::uint32_t carry = 0;
+            for (auto &l: _limbs) {
+                std::uint32_t nc = l >> (32 - b);
+                l = (l << b) | carry;
+                carry = nc;
             }
-
-            if (negexp) d1_exponent = -d1_exponent;
+            if (carry) _limbs.push_back(carry);
         }
+    }
+    int compare(const BigUInt &other) const {
+        if (_limbs.size() != other._limbs.size()) return _limbs.size() < other._limbs.size()?-1:1;
+        for (std::size_t i = _limbs.size(); i-- > 0;) {
+            if (_limbs[i] != other._limbs[i]) return _limbs[i] < other._limbs[i]?-1:1;
+        }
+        return 0;
+    }
+protected:
+    std::vector<std::uint32_t> _limbs;
+};
 
+///Decides rounding using exact arithmetic
+/**
+ * @param d parsed number
+ * @param bits candidate, the correct result is either this, or next double
+ * @return correct result
+ */
+inline std::uint64_t round_decimal_exact(const ParsedDecimal &d, std::uint64_t bits) {
+    //more digits can't change the result, the rest is replaced by a sticky digit
+    constexpr std::size_t max_digits = 800;
+    BigUInt num(0);
+    std::size_t cnt = 0;
+    bool sticky = false;
+    std::int64_t e = d.exp_part - static_cast<std::int64_t>(d.frac_part.size());
+    for (std::string_view part: {d.int_part, d.frac_part}) {
+        for (char c: part) {
+            if (cnt < max_digits) {
+                num.mul_add(10, static_cast<std::uint32_t>(c - '0'));
+                if (cnt || c != '0') ++cnt;
+            } else {
+                sticky = sticky || c != '0';
+                ++e;
+            }
+        }
     }
-    //compose final number d1*10^d1_exponent + d2*10^(d1_exponent+d2_exponent)
-    double res = d1 * std::pow(10, d1_exponent) + d2*std::pow(10, d1_exponent+d2_exponent);
+    if (sticky) {
+        num.mul_add(10, 1);
+        --e;
+    }
+    //midpoint between bits and next double: (2m+1)*2^(p-1)
+    std::uint64_t m = bits & ((std::uint64_t(1) << 52) - 1);
+    int be = static_cast<int>(bits >> 52);
+    std::int64_t p = be?be - 1075:-1074;
+    if (be) m |= std::uint64_t(1) << 52;
+    BigUInt mid(2 * m + 1);
+    //num*10^e <=> mid*2^(p-1)
+    if (e >= 0) num.mul_pow5(e); else mid.mul_pow5(-e);
+    std::int64_t s = e - (p - 1);
+    if (s > 0) num.shl(s); else mid.shl(-s);
+    int cmp = num.compare(mid);
+    if (cmp > 0 || (cmp == 0 && (bits & 1))) ++bits;
+    return bits;
+}
 
-    if (isneg) res = -res;
-    return res;
+///Converts parsed decimal number to double (correctly rounded)
+inline double decimalToDouble(const ParsedDecimal &d) {
+    double res;
+    std::uint64_t w = d.mantissa;
+    std::int64_t q = d.exponent;
+    if (w == 0 || q < Pow10Table::min_exponent) {
+        res = 0;
+    } else if (q > 308) {
+        res = std::numeric_limits<double>::infinity();
+    } else {
+#if FLT_EVAL_METHOD == 0
+        //Clinger's fast path - both numbers are exact, so single operation is correctly rounded
+        static constexpr double pow10[] = {1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,
+                1e11,1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22};
+        if (!d.truncated && w <= (std::uint64_t(1) << 53) && q >= -22 && q <= 22) {
+            res = static_cast<double>(w);
+            if (q < 0) res /= pow10[-q]; else res *= pow10[q];
+            return d.negative?-res:res;
+        }
+#endif
+        std::uint64_t bits = eisel_lemire(w, static_cast<int>(q));
+        //more digits follow, result is between w and w+1
+        if (d.truncated && eisel_lemire(w+1, static_cast<int>(q)) != bits) {
+            bits = round_decimal_exact(d, bits);
+        }
+        std::memcpy(&res, &bits, sizeof(res));
+    }
+    return d.negative?-res:res;
 }
 
+
 }
 
 template<std::size_t n>
@@ -365,6 +845,11 @@ struct StrBuff {
     void push_back(char c) {
         if (pos < n) buff[pos++] = c;
     }
+    void append(const char *s, std::size_t len) {
+        len = std::min(len, n - pos);
+        std::memcpy(buff+pos, s, len);
+        pos += len;
+    }
     operator std::string_view() const {
         return std::string_view(buff, pos);
     }
@@ -386,9 +871,15 @@ template<int base, typename Number>
 auto unsigned_to_string(const Number &n) {
     constexpr std::size_t sz = std::numeric_limits<Number>::digits*logn(2,base) +4; 
     StrBuff<sz> out;
-    _details::unsignedToString(n, [&](char c){
-            out.push_back(c);
-        });
+    if constexpr(base == 10 && sizeof(Number) <= sizeof(std::uint64_t)) {
+        char buff[20];
+        char *b = _details::write_decimal(n, buff+20);
+        out.append(b, buff+20-b);
+    } else {
+        _details::unsignedToString(n, [&](char c){
+                out.push_back(c);
+            }, base);
+    }
     return out;
 }
 
@@ -396,14 +887,33 @@ template<int base, typename Number>
 auto signed_to_string(const Number &n) {
     constexpr std::size_t sz = std::numeric_limits<Number>::digits*logn(2,base) +4; 
     StrBuff<sz> out;
-    _details::unsignedToString(n, [&](char c){
-            out.push_back(c);
+    if constexpr(base == 10 && sizeof(Number) <= sizeof(std::uint64_t)) {
+        char buff[21];
+        std::uint64_t u = n < 0?std::uint64_t(0) - static_cast<std::uint64_t>(n):static_cast<std::uint64_t>(n);
+        char *b = _details::write_decimal(u, buff+21);
+        if (n < 0) *--b = '-';
+        out.append(b, buff+21-b);
+    } else {
+        _details::signedToString(n, [&](char c){
+                out.push_back(c);
+            }, base);
+    }
+    return out;
+}
+
+///Converts floating point number to shortest string, which parses back to same number
+template<typename Number>
+auto float_to_string(const Number &n) {
+    StrBuff<30> out;
+    _details::floatToShortestString(n, [&](char c){
+                out.push_back(c);
         });
     return out;
 }
 
+///Converts floating point number to string with limited precision
 template<typename Number>
-auto float_to_string(const Number &n, int maxPrecisionDigits=14) {
+auto float_to_string(const Number &n, int maxPrecisionDigits) {
     StrBuff<30> out;
     _details::floatToString(n, [&](char c){
                 out.push_back(c);
@@ -413,30 +923,121 @@ auto float_to_string(const Number &n, int maxPrecisionDigits=14) {
 
 template<typename T, int base = 10>
 auto string_to_unsigned(std::string_view &&s) {
-    return _details::stringToUnsigned<T>(std::move(s), base);
+    if constexpr(base == 10 && sizeof(T) <= sizeof(std::uint64_t)) {
+        return _details::decimalToUnsigned<T>(s);
+    } else {
+        return _details::stringToUnsigned<T>(std::move(s), base);
+    }
 }
 
 template<typename T, int base = 10>
 auto string_to_signed(std::string_view &&s) {
-    return _details::stringToSigned<T>(std::move(s), base);
+    if constexpr(base == 10 && sizeof(T) <= sizeof(std::uint64_t)) {
+        return _details::decimalToSigned<T>(s);
+    } else {
+        return _details::stringToSigned<T>(std::move(s), base);
+    }
 }
 
 
+///Converts string to double (correctly rounded)
+/**
+ * @param s string, which starts by a number. The variable receives unprocessed part of
+ * the string
+ * @return parsed number, or 0 if the string doesn't start by a number
+ */
 inline double string_to_float(std::string_view &&s) {
-    bool consumed = false;
-    auto iter = s.begin();
-    auto e = s.end();
-    double z = _details::parseDoubleNumber([&]()->int {
-      if (iter == e) {
-          consumed = true;
-          return -1;
-      }
-      else return *iter++;
-    });
-    if (!consumed) s = s.substr(std::distance(s.begin(), iter)-1);
-    else s = std::string_view();
-    return z;
+    _details::ParsedDecimal d;
+    const char *end = _details::parseDecimal(s.data(), s.data()+s.size(), d);
+    if (!end) return 0;
+    s = s.substr(end - s.data());
+    return _details::decimalToDouble(d);
+}
+
+namespace _details {
+
+template<typename T> struct DecimalMagnitude;
+template<> struct DecimalMagnitude<std::int64_t> {using type = std::uint64_t;};
+#ifdef __SIZEOF_INT128__
+template<> struct DecimalMagnitude<__int128> {using type = unsigned __int128;};
+#endif
+
+}
+
+///Converts string to fixed-point decimal number
+/**
+ * The number is converted exactly, without going through floating point.
+ *
+ * @param s string which contains a number (whole string must be a number, exponent is allowed)
+ * @param scale count of decimal places. The result is the number multiplied by 10^scale
+ * @return scaled number. Returns no value, if the string is not a number, if the result
+ * doesn't fit to the type, or if the number has more (non-zero) decimal places than the scale
+ *
+ * @tparam T std::int64_t or __int128 (where supported)
+ */
+template<typename T>
+std::optional<T> string_to_decimal(const std::string_view &s, unsigned int scale) {
+    using U = typename _details::DecimalMagnitude<T>::type;
+    const char *iter = s.data();
+    const char *end = iter + s.size();
+    auto is_digit = [](char c) {return static_cast<unsigned char>(c - '0') < 10;};
+    bool neg = false;
+    if (iter != end && (*iter == '-' || *iter == '+')) {
+        neg = *iter == '-';
+        ++iter;
+    }
+    const char *int_beg = iter;
+    while (iter != end && is_digit(*iter)) ++iter;
+    const char *int_end = iter;
+    const char *frac_beg = iter;
+    if (iter != end && *iter == '.') {
+        frac_beg = ++iter;
+        while (iter != end && is_digit(*iter)) ++iter;
+    }
+    const char *frac_end = iter;
+    if (int_beg == int_end && frac_beg == frac_end) return {};
+    std::int64_t exp = 0;
+    if (iter != end && (*iter == 'e' || *iter == 'E')) {
+        ++iter;
+        bool eneg = false;
+        if (iter != end && (*iter == '-' || *iter == '+')) {
+            eneg = *iter == '-';
+            ++iter;
+        }
+        if (iter == end || !is_digit(*iter)) return {};
+        while (iter != end && is_digit(*iter)) {
+            //saturate, such exponent can't produce valid result anyway
+            if (exp < 1000000000) exp = exp * 10 + (*iter - '0');
+            ++iter;
+        }
+        if (eneg) exp = -exp;
+    }
+    if (iter != end) return {};
 
+    //result = digits * 10^shift
+    std::int64_t digits = (int_end - int_beg) + (frac_end - frac_beg);
+    std::int64_t shift = exp + scale - (frac_end - frac_beg);
+    std::int64_t keep = shift < 0?std::max<std::int64_t>(digits + shift, 0):digits;
+    U limit = ~U(0) >> 1;
+    if (neg) ++limit;
+    U v = 0;
+    auto push = [&](unsigned int d) {
+        if (v > (limit - d) / 10) return false;
+        v = v * 10 + d;
+        return true;
+    };
+    for (std::int64_t i = 0; i < digits; ++i) {
+        char c = i < (int_end - int_beg)?int_beg[i]:frac_beg[i - (int_end - int_beg)];
+        if (i < keep) {
+            if (!push(c - '0')) return {};
+        } else if (c != '0') {
+            return {};  //decimal places are lost
+        }
+    }
+    for (std::int64_t i = 0; i < shift && v; ++i) {
+        if (!push(0)) return {};
+    }
+    return neg?static_cast<T>(U(0) - v):static_cast<T>(v);
 }
 
 
@@ -0,0 +1,458 @@
+/*
+ * parallel.h
+ *
+ *  Created on: 16. 10. 2026
+ */
+
+#ifndef KISSJSON_PARALLEL_H_
+#define KISSJSON_PARALLEL_H_
+
+#include "parser.h"
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <istream>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace kjson {
+
+///Simple pool of worker threads
+/**
+ * The pool executes one job at time. The job is a function called for every index
+ * of a range. Indexes are distributed between workers and the calling thread
+ */
+class WorkerPool {
+public:
+
+    ///Construct pool
+    /**
+     * @param threads total count of threads including the calling thread. Zero
+     * means count of available CPU cores
+     */
+    explicit WorkerPool(unsigned int threads = 0);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    ///Retrieves count of threads executing jobs (including the calling thread)
+    unsigned int size() const {return static_cast<unsigned int>(_threads.size()+1);}
+
+    ///Execute job
+    /**
+     * @param count count of indexes
+     * @param fn function called for every index from 0 to count-1. Function is called
+     * from multiple threads
+     *
+     * Function returns when all indexes are processed. If the function throws an exception,
+     * the exception is rethrown here. If there were more exceptions, the exception of the
+     * lowest index is rethrown, so the result doesn't depend on timing of threads
+     */
+    void run(std::size_t count, const std::function<void(std::size_t)> &fn);
+
+protected:
+    std::mutex _mx;
+    std::condition_variable _start_cond;
+    std::condition_variable _done_cond;
+    const std::function<void(std::size_t)> *_job = nullptr;
+    std::size_t _count = 0;
+    std::atomic<std::size_t> _next = {0};
+    unsigned int _running = 0;
+    unsigned int _generation = 0;
+    bool _exit = false;
+    std::exception_ptr _exception;
+    ///index which thrown _exception
+    std::size_t _exception_index = 0;
+    std::vector<std::thread> _threads;
+
+    void worker();
+    void work_loop(const std::function<void(std::size_t)> &fn);
+};
+
+inline WorkerPool::WorkerPool(unsigned int threads) {
+    if (threads == 0) threads = std::max(1U, std::thread::hardware_concurrency());
+    for (unsigned int i = 1; i < threads; ++i) {
+        _threads.push_back(std::thread([this]{worker();}));
+    }
+}
+
+inline WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard _(_mx);
+        _exit = true;
+    }
+    _start_cond.notify_all();
+    for (auto &t: _threads) t.join();
+}
+
+inline void WorkerPool::run(std::size_t count, const std::function<void(std::size_t)> &fn) {
+    {
+        std::lock_guard _(_mx);
+        _job = &fn;
+        _count = count;
+        _next = 0;
+        _running = static_cast<unsigned int>(_threads.size());
+        _exception = nullptr;
+        ++_generation;
+    }
+    _start_cond.notify_all();
+    work_loop(fn);
+    std::unique_lock lk(_mx);
+    _done_cond.wait(lk, [&]{return _running == 0;});
+    _job = nullptr;
+    if (_exception) std::rethrow_exception(std::exchange(_exception, nullptr));
+}
+
+inline void WorkerPool::worker() {
+    unsigned int generation = 0;
+    std::unique_lock lk(_mx);
+    while (true) {
+        _start_cond.wait(lk, [&]{return _exit || generation != _generation;});
+        if (_exit) break;
+        generation = _generation;
+        const auto &fn = *_job;
+        lk.unlock();
+        work_loop(fn);
+        lk.lock();
+        if (--_running == 0) _done_cond.notify_all();
+    }
+}
+
+inline void WorkerPool::work_loop(const std::function<void(std::size_t)> &fn) {
+    std::size_t idx = _next++;
+    try {
+        while (idx < _count) {
+            fn(idx);
+            idx = _next++;
+        }
+    } catch (...) {
+        std::lock_guard _(_mx);
+        if (!_exception || idx < _exception_index) {
+            _exception = std::current_exception();
+            _exception_index = idx;
+        }
+        //skip remaining work. Lower indexes are already taken, they are finished
+        //and can report an exception with lower index
+        _next = _count;
+    }
+}
+
+///Reads stream of JSON records and parses them in parallel
+/**
+ * Input is split into chunks at record boundaries. Chunks are parsed by the worker
+ * pool. Supported formats
+ *
+ * - NDJSON - one record per line
+ * - JSON text sequences (RFC 7464) - every record is prefixed by the record separator (0x1E)
+ * - concatenated JSON documents - boundaries are found by a structural scan
+ *
+ * @code
+ * NDJsonReader rd;
+ * rd.read(text, [&](const Value &rec){process(rec);});
+ * @endcode
+ */
+class NDJsonReader {
+public:
+
+    enum class Format {
+        ///newline delimited json
+        ndjson,
+        ///JSON text sequence (RFC 7464)
+        json_seq,
+        ///concatenated documents (whitespace between documents is optional)
+        concatenated
+    };
+
+    enum class Delivery {
+        ///records are delivered in the order of input, callback is called by the calling thread
+        ordered,
+        ///records are delivered as soon as they are parsed, callback is called by worker
+        ///threads concurrently, so it must be MT safe
+        unordered
+    };
+
+    ///Callback, which receives parsed records
+    using Callback = std::function<void(const Value &)>;
+
+    ///Default size of one chunk
+    static constexpr std::size_t default_chunk_size = 1024*1024;
+
+    ///Construct reader
+    /**
+     * @param format format of input
+     * @param delivery order of delivery
+     * @param threads count of threads, zero means count of CPU cores
+     */
+    explicit NDJsonReader(Format format = Format::ndjson, Delivery delivery = Delivery::ordered, unsigned int threads = 0)
+        :_format(format), _delivery(delivery), _pool(threads) {}
+
+    ///Set size of chunk (default 1MB)
+    /**
+     * A chunk is processed by one thread at time. Record is never split, so a chunk can
+     * be larger if it ends in a middle of a large record
+     */
+    void set_chunk_size(std::size_t sz) {_chunk_size = std::max<std::size_t>(sz, 1);}
+
+    ///Read records from a text
+    /**
+     * @param text whole input (for example memory mapped file)
+     * @param cb callback
+     * @exception ParseError invalid record. Offset in the error is relative to the record
+     */
+    void read(std::string_view text, const Callback &cb) {
+        process(text, cb, true);
+    }
+
+    ///Read records from a stream
+    /**
+     * @param in input stream, it is read in large blocks until the end of stream is reached
+     * @param cb callback
+     * @exception ParseError invalid record. Offset in the error is relative to the record
+     */
+    void read(std::istream &in, const Callback &cb);
+
+protected:
+    Format _format;
+    Delivery _delivery;
+    WorkerPool _pool;
+    std::size_t _chunk_size = default_chunk_size;
+
+    static constexpr char record_separator = '\x1E';
+
+    std::size_t process(std::string_view text, const Callback &cb, bool eof);
+    std::vector<std::size_t> find_cuts(std::string_view text, bool eof) const;
+    std::size_t find_concatenated_cuts(std::string_view text, std::vector<std::size_t> &cuts) const;
+    static void parse_chunk(std::string_view text, const Callback &cb);
+    static bool is_white(char c) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == record_separator;
+    }
+};
+
+inline void NDJsonReader::read(std::istream &in, const Callback &cb) {
+    std::string buff;
+    std::size_t block = _chunk_size * _pool.size() * 4;
+    bool eof = false;
+    while (!eof) {
+        std::size_t sz = buff.size();
+        buff.resize(sz + block);
+        in.read(buff.data()+sz, block);
+        buff.resize(sz + in.gcount());
+        eof = !in;
+        std::size_t consumed = process(buff, cb, eof);
+        buff.erase(0, consumed);
+    }
+}
+
+inline std::size_t NDJsonReader::process(std::string_view text, const Callback &cb, bool eof) {
+    std::vector<std::size_t> cuts = find_cuts(text, eof);
+    std::size_t chunks = cuts.size()-1;
+    auto chunk = [&](std::size_t idx) {
+        return text.substr(cuts[idx], cuts[idx+1] - cuts[idx]);
+    };
+    if (_delivery == Delivery::unordered) {
+        _pool.run(chunks, [&](std::size_t idx) {
+            parse_chunk(chunk(idx), cb);
+        });
+    } else {
+        //results are collected in batches to limit memory usage
+        std::size_t batch = _pool.size() * 4;
+        std::vector<std::vector<Value> > results(batch);
+        for (std::size_t b = 0; b < chunks; b += batch) {
+            std::size_t cnt = std::min(batch, chunks - b);
+            _pool.run(cnt, [&](std::size_t idx) {
+                auto &r = results[idx];
+                parse_chunk(chunk(b+idx), [&](const Value &v){r.push_back(v);});
+            });
+            for (std::size_t i = 0; i < cnt; ++i) {
+                for (const Value &v: results[i]) cb(v);
+                results[i].clear();
+            }
+        }
+    }
+    return cuts.back();
+}
+
+inline std::vector<std::size_t> NDJsonReader::find_cuts(std::string_view text, bool eof) const {
+    std::vector<std::size_t> cuts;
+    cuts.push_back(0);
+    std::size_t last_end;
+    if (_format == Format::concatenated) {
+        last_end = find_concatenated_cuts(text, cuts);
+    } else {
+        //ndjson cuts after new line, json_seq cuts before the separator
+        char sep = _format == Format::ndjson?'\n':record_separator;
+        std::size_t adj = _format == Format::ndjson?1:0;
+        std::size_t target = _chunk_size;
+        while (target < text.size()) {
+            auto p = text.find(sep, target);
+            if (p == text.npos) break;
+            if (p + adj > cuts.back()) cuts.push_back(p + adj);
+            target = p + adj + _chunk_size;
+        }
+        auto p = text.rfind(sep);
+        last_end = p == text.npos?0:p + adj;
+    }
+    if (eof) last_end = text.size();
+    while (cuts.size() > 1 && cuts.back() > last_end) cuts.pop_back();
+    if (last_end > cuts.back()) cuts.push_back(last_end);
+    return cuts;
+}
+
+inline std::size_t NDJsonReader::find_concatenated_cuts(std::string_view text, std::vector<std::size_t> &cuts) const {
+    int depth = 0;
+    std::size_t last_end = 0;
+    StructuralIndex::scan(text, [&](std::size_t p, char c) {
+        switch (c) {
+            case '{':
+            case '[': ++depth; break;
+            case '}':
+            case ']': if (--depth == 0) {
+                          last_end = p+1;
+                          if (last_end - cuts.back() >= _chunk_size) cuts.push_back(last_end);
+                      }
+                      break;
+            default: break;
+        }
+        return true;
+    });
+    return last_end;
+}
+
+inline void NDJsonReader::parse_chunk(std::string_view text, const Callback &cb) {
+    //one parser for the whole chunk, its buffers are reused by all records
+    Parser parser;
+    while (true) {
+        std::size_t p = 0;
+        while (p < text.size() && is_white(text[p])) ++p;
+        if (p == text.size()) break;
+        text = text.substr(p);
+        auto r = parser.parse_buffer(text);
+        if (r.first) {
+            parser.put_eof();
+            text = std::string_view();
+        } else {
+            text = r.second;
+        }
+        cb(parser.get_result());
+        parser.reset();
+    }
+}
+
+///Parse single large document using multiple threads
+/**
+ * Top-level container is split into regions at its commas, which are found by a quick
+ * structural scan. Regions are parsed in parallel and the results are stitched into one
+ * container. Small documents and documents, which are not containers, are parsed by single
+ * thread.
+ *
+ * @param text JSON text
+ * @param pool worker pool
+ * @param min_region minimal size of one region in bytes.
+ * @return parsed value, same as Value::from_string()
+ * @exception ParseError invalid document
+ */
+Value parse_parallel(std::string_view text, WorkerPool &pool, std::size_t min_region = 64*1024);
+
+namespace _details {
+
+///Creates parse error for character at given index (reports same position as Parser)
+inline ParseError make_parse_error(ParseError::Error err, std::string_view text, std::size_t index) {
+    std::size_t offset = std::min(index+1, text.size());
+    std::size_t line = 0;
+    std::size_t begline = 0;
+    for (std::size_t i = 0; i < offset; ++i) {
+        if (text[i] == '\n') {
+            ++line;
+            begline = i+1;
+        }
+    }
+    return ParseError(err, offset, line+1, offset-begline-1);
+}
+
+}
+
+inline Value parse_parallel(std::string_view text, WorkerPool &pool, std::size_t min_region) {
+    std::size_t root = 0;
+    while (root < text.size() && DefaultParserPolicy::is_space(text[root])) ++root;
+    if (pool.size() < 2 || root == text.size() || text.size() - root < 2*min_region
+            || (text[root] != '[' && text[root] != '{')) {
+        return Parser::parse_string(text);
+    }
+    bool is_object = text[root] == '{';
+    std::size_t region = std::max(min_region, text.size()/(pool.size()*8));
+    //cuts are offsets of selected top-level commas, the last is the closing bracket
+    std::vector<std::size_t> cuts;
+    cuts.push_back(root);
+    int depth = 0;
+    bool closed = false;
+    StructuralIndex::scan(text.substr(root), [&](std::size_t p, char c) {
+        p += root;
+        switch (c) {
+            case '{':
+            case '[': ++depth; break;
+            case '}':
+            case ']': if (--depth == 0) {
+                          cuts.push_back(p);
+                          closed = true;
+                          return false;
+                      }
+                      break;
+            case ',': if (depth == 1 && p - cuts.back() >= region) cuts.push_back(p);
+                      break;
+            default: break;
+        }
+        return true;
+    });
+    //unbalanced document, let the parser report the error
+    if (!closed) return Parser::parse_string(text);
+
+    std::size_t count = cuts.size()-1;
+    std::vector<Value> parts(count);
+    std::string_view open = is_object?"{":"[";
+    std::string_view close = is_object?"}":"]";
+    pool.run(count, [&](std::size_t idx) {
+        std::size_t b = cuts[idx]+1;
+        std::size_t e = cuts[idx+1];
+        Parser p;
+        try {
+            p.parse_buffer(open);
+            p.parse_buffer(text.substr(b, e - b));
+            if (p.parse_buffer(close).first) p.put_eof();
+        } catch (const ParseError &err) {
+            //first character fed to the parser is the artificial opening bracket
+            throw _details::make_parse_error(err.get_error(), text, b + err.get_offset() - 2);
+        }
+        //an empty region is allowed only for empty container. The result can't be
+        //used to detect it, members 'undefined' are dropped
+        if (count > 1 && std::all_of(text.begin()+b, text.begin()+e, DefaultParserPolicy::is_space)) {
+            throw _details::make_parse_error(ParseError::Error::unexpected_character, text, e);
+        }
+        parts[idx] = p.get_result();
+    });
+
+    std::size_t total = 0;
+    for (const Value &v: parts) total += v.size();
+    auto builder = [&](ContBuilder &bld) {
+        for (const Value &v: parts) {
+            for (const Value &itm: v) bld.push_back(itm.get_handle());
+        }
+    };
+    if (is_object) {
+        return Value(Node::new_object(total, [&](ContBuilder &bld) {
+            builder(bld);
+            std::sort(bld.begin(),bld.end(),Node::KeyOrder());
+        }));
+    } else {
+        return Value(Node::new_array(total, builder));
+    }
+}
+
+}
+
+
+
+#endif /* KISSJSON_PARALLEL_H_ */
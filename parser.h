@@ -9,8 +9,11 @@
 #define KISSJSON_PARSER_H_
 
 #include "value.h"
+#include "structural_index.h"
 #include <vector>
 #include <sstream>
+#include <functional>
+#include <memory>
 
 namespace kjson {
 
@@ -29,6 +32,7 @@ public:
         expected_colon,
         expected_begin_of_string,
         unexpected_end_of_file,
+        invalid_utf8,
     };
 
     ParseError(Error err, std::size_t offset, std::size_t line, std::size_t col)
@@ -60,9 +64,14 @@ public:
             case Error::expected_colon: return "Expected colon";
             case Error::expected_begin_of_string: return "Expected begin of string (quotes)";
             case Error::unexpected_end_of_file: return "Unexpected end of file";
+            case Error::invalid_utf8: return "Invalid UTF-8 sequence";
             default: return "Unknown error";
         }
     }
+    Error get_error() const {return _err;}
+    std::size_t get_offset() const {return _offset;}
+    std::size_t get_line() const {return _line;}
+    std::size_t get_column() const {return _col;}
 
 protected:
     Error _err;
@@ -71,13 +80,108 @@ protected:
 
 };
 
-class Parser {
+///Receives events from the Parser (SAX style parsing)
+/**
+ * When the Parser is constructed with a handler, it doesn't build the Value. Instead,
+ * it calls the handler for every parsed element. The parser doesn't allocate nodes in
+ * this mode. Strings passed to the handler are valid only during the call.
+ */
+class ParseHandler {
 public:
+    virtual ~ParseHandler() = default;
+
+    ///Begin of an object
+    virtual void start_object() = 0;
+    ///End of an object
+    virtual void end_object() = 0;
+    ///Begin of an array
+    virtual void start_array() = 0;
+    ///End of an array
+    virtual void end_array() = 0;
+    ///Key of next member of an object
+    virtual void key(std::string_view key) = 0;
+    ///String value (already decoded)
+    virtual void string(std::string_view str) = 0;
+    ///Number value (text of the number as it appears in the JSON)
+    virtual void number(std::string_view num) = 0;
+    ///Boolean value
+    virtual void boolean(bool b) = 0;
+    ///Null value
+    virtual void null() = 0;
+    ///Keyword 'undefined' (extension, default implementation ignores it)
+    virtual void undefined() {}
+};
+
+///Default parser policy
+/**
+ * Policy selects features of the parser at compile time. To create own policy,
+ * inherit this structure and override its members
+ */
+struct DefaultParserPolicy {
+    ///Track offset, line and column for error reports. If disabled, errors report zero position
+    static constexpr bool track_position = true;
+    ///Allow keyword 'undefined'
+    static constexpr bool allow_undefined = true;
+    ///Allow comments // and /* */ where whitespaces are allowed
+    static constexpr bool allow_comments = false;
+    ///Allow comma after the last item of an array or an object
+    static constexpr bool allow_trailing_commas = false;
+    ///Validate UTF-8 encoding of strings. Error is reported as Error::invalid_utf8
+    static constexpr bool validate_utf8 = false;
+    ///Allow sign '+' before a number
+    static constexpr bool allow_plus_sign = true;
+    ///Allow leading zeroes of numbers (012)
+    static constexpr bool allow_leading_zeroes = true;
+    ///Allow unescaped control characters (below 0x20) in strings
+    static constexpr bool allow_control_characters = true;
+    ///Classifies whitespace characters (locale independent, same as isspace() in "C" locale)
+    static constexpr bool is_space(char c) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+    }
+};
 
-    Parser() = default;
+///Strict RFC 8259 grammar, no extensions
+struct StrictParserPolicy: DefaultParserPolicy {
+    static constexpr bool allow_undefined = false;
+    static constexpr bool validate_utf8 = true;
+    static constexpr bool allow_plus_sign = false;
+    static constexpr bool allow_leading_zeroes = false;
+    static constexpr bool allow_control_characters = false;
+    static constexpr bool is_space(char c) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+    }
+};
+
+///Default grammar, UTF-8 encoding of strings is validated
+struct ValidatingParserPolicy: DefaultParserPolicy {
+    static constexpr bool validate_utf8 = true;
+};
+
+///Extended grammar - undefined, comments, trailing commas
+struct ExtendedParserPolicy: DefaultParserPolicy {
+    static constexpr bool allow_comments = true;
+    static constexpr bool allow_trailing_commas = true;
+};
+
+///JSON parser
+/**
+ * @tparam Policy parser policy, see DefaultParserPolicy
+ */
+template<typename Policy>
+class BasicParser {
+public:
+
+    BasicParser() = default;
+    ///Construct parser in event mode
+    /**
+     * @param handler handler which receives parsed elements. Handler must stay valid
+     * while the parser is in use. The parser doesn't produce result in this mode, get_result()
+     * returns undefined
+     */
+    explicit BasicParser(ParseHandler &handler):_handler(&handler) {}
     ///Copy constructor can't copy internal state, but we still need to create new object
-    Parser(const Parser &) {}
-    Parser &operator=(const Parser &) = delete;
+    BasicParser(const BasicParser &) {}
+    BasicParser &operator=(const BasicParser &) = delete;
 
     ///Puts char to the parser
     /**
@@ -108,6 +212,49 @@ public:
      */
     static Value parse_string(const std::string_view &s);
 
+    ///Parse string using prebuilt structural index
+    /**
+     * @param index structural index of the text. The parser uses the index only to skip
+     * string content quickly, other tokens are scanned as without the index. Result is
+     * the same as parsing without the index
+     * @return parsed JSON
+     */
+    static Value parse_string(const StructuralIndex &index);
+
+    ///Parse string using prebuilt structural index, containers are allocated with exact size
+    /**
+     * Counts of items of all containers are calculated from the index in advance. Parsed
+     * items are then stored directly into their containers, without an intermediate
+     * stack. Result is the same as parsing without the index
+     *
+     * @param index structural index of the text
+     * @return parsed JSON
+     */
+    static Value parse_exact(const StructuralIndex &index);
+
+    ///Parse text in-situ - without copying strings and numbers
+    /**
+     * Strings without escape sequences and numbers are not copied into the nodes,
+     * the nodes reference the text directly. Every such node holds a reference to
+     * the owner, so the text stays valid while there is a node which references it.
+     *
+     * @param text JSON text
+     * @param owner value which owns the text (for example string value, or
+     * user defined value which holds a mapped file)
+     * @return parsed JSON
+     */
+    static Value parse_in_situ(const std::string_view &text, const Value &owner);
+
+    ///Parse text in-situ - without copying strings and numbers
+    /**
+     * @param text string value which contains JSON text. The value is also owner of
+     * the text
+     * @return parsed JSON
+     */
+    static Value parse_in_situ(const Value &text) {
+        return parse_in_situ(text.get_string(), text);
+    }
+
 
     ///Parse buffer, can be incomplette
     /**
@@ -120,6 +267,118 @@ public:
      */
     std::pair<bool, std::string_view> parse_buffer(const std::string_view &s);
 
+    ///Parse contiguous span of characters
+    /**
+     * Bulk variant of put_char(). It processes whole runs of characters (whitespaces,
+     * string content, digits) at once and falls back to the per-character state machine
+     * only when it is necessary.
+     *
+     * @param iter begin of the span
+     * @param end end of the span
+     * @return pointer to first unprocessed character. If the parser is not in the
+     * ready state, the whole span has been processed (returns end)
+     */
+    const char *parse_span(const char *iter, const char *end);
+
+    ///Allocate nodes of the parsed document in the arena
+    /**
+     * @param arena arena used to allocate nodes. The arena is activated only while
+     * the parser processes input. Set nullptr to use default allocator
+     *
+     * @note Nodes allocated in the arena keep their chunks alive. Use the arena for
+     * documents which are released as a whole, not for long living parts of them
+     */
+    void set_arena(NodeArena *arena) {_arena = arena;}
+
+    ///Intern keys of parsed objects in the key table
+    /**
+     * @param keys key table. It can be shared by multiple parsers (but not by multiple
+     * threads). Set nullptr to disable interning
+     */
+    void set_key_table(KeyTable *keys) {_key_table = keys;}
+
+    ///Enable cache of short strings
+    /**
+     * Parsed strings are looked up in a small direct mapped cache. If the same string
+     * was parsed recently, its node is shared instead of allocating a new one. This
+     * helps with documents which repeat enum-like values.
+     *
+     * @param slots count of slots of the cache (rounded up to power of two). Set 0 to
+     * disable the cache
+     * @param max_length strings longer than this are not cached
+     *
+     * @note Cached nodes are allocated by the default allocator (never in the arena) and
+     * they keep a copy of the text, because the cache is kept by reset()
+     */
+    void set_string_cache(std::size_t slots, std::size_t max_length = 32) {
+        std::size_t sz = slots?1:0;
+        while (sz < slots) sz <<= 1;
+        _string_cache.clear();
+        _string_cache.resize(sz, nullptr);
+        _string_cache_max_length = max_length;
+    }
+
+    ///Callback which receives elements of streamed array
+    using ElementCallback = std::function<void(const Value &)>;
+
+    ///Stream elements of an array instead of collecting them
+    /**
+     * Every element of the selected array is passed to the callback as soon as it is
+     * complete. The element is not stored in the result, so memory usage is limited by
+     * the largest element, not by the whole array. The array appears empty in the result.
+     *
+     * @param cb callback
+     * @param path path to the array. It is an array of keys (strings) and indexes (numbers).
+     * Default value selects the top-level array
+     *
+     * @code
+     * Parser p;
+     * p.stream_elements([&](const Value &v){process(v);}, Array{"result","items"});
+     * @endcode
+     */
+    void stream_elements(ElementCallback cb, const Value &path = Array()) {
+        _element_cb = std::move(cb);
+        _stream_path = path;
+    }
+
+    ///Reset the parser to parse next document
+    /**
+     * Internal buffers keep their capacity, so parsing of next document doesn't need
+     * to allocate them again (buffers larger than max_retained_capacity are released).
+     * Configuration (handler, arena, key table, string cache, streamed array) is kept.
+     */
+    void reset();
+
+    ///Reset the parser and its configuration
+    /**
+     * Same as reset(), it also removes handler, arena, key table, string cache and
+     * streamed array. The parser is in the same state as newly constructed parser
+     */
+    void reset_all();
+
+    ///Buffers with larger capacity are released by reset()
+    static constexpr std::size_t max_retained_capacity = 64*1024;
+
+    ///Parser borrowed from thread local pool, it is reset and returned on destruction
+    /**
+     * @code
+     * Parser::Pooled p;
+     * p->parse_buffer(data);
+     * @endcode
+     */
+    class Pooled {
+    public:
+        Pooled();
+        ~Pooled();
+        Pooled(const Pooled &) = delete;
+        Pooled &operator=(const Pooled &) = delete;
+        BasicParser *operator->() const {return _p.get();}
+        BasicParser &operator*() const {return *_p;}
+    protected:
+        std::unique_ptr<BasicParser> _p;
+        static std::vector<std::unique_ptr<BasicParser> > &pool();
+    };
+
 protected:
 
     Value _result;
@@ -148,28 +407,59 @@ protected:
         parse_number_exponent_digit2,
         close_object,
         close_array,
-        colon
+        colon,
+        comment_begin,
+        comment_line,
+        comment_block,
+        comment_block_end
     };
 
     using Error = ParseError::Error;
 
     State _state = State::detect_type;
+    State _comment_ret = State::detect_type;
     bool _string_is_key = false;
-    std::vector<Value> _vstack;
+    std::vector<PNode> _vstack;
     std::vector<std::pair<std::size_t, bool> >_items;
     std::string _strbuff;
     std::vector<std::size_t> _stritems;
 
+    const StructuralIndex *_index = nullptr;
+    PNode _source_owner = nullptr;
+    NodeArena *_arena = nullptr;
+    KeyTable *_key_table = nullptr;
+    std::vector<PNode> _string_cache;
+    std::size_t _string_cache_max_length = 0;
+    ParseHandler *_handler = nullptr;
+    ElementCallback _element_cb;
+    Value _stream_path;
+    static constexpr std::size_t no_stream_level = static_cast<std::size_t>(-1);
+    ///level of _items which contains streamed array
+    std::size_t _stream_level = no_stream_level;
+    std::vector<std::uint32_t>::const_iterator _index_iter;
+
     std::size_t _chcnt = 0;
     std::size_t _line = 0;
     std::size_t _begline = 0;
 
+    _simd::Utf8Validator _utf8;
+
     void push_string();
     std::string_view top_string();
     void pop_string();
 
     void push_container(bool is_object);
-    Value top_container();
+    bool match_stream_path() const;
+    PNode top_container();
+    void push_item(PNode &&item);
+
+    ///exact sizes of containers in order of appearance (exact size mode)
+    std::vector<std::uint32_t> _exact_sizes;
+    std::size_t _exact_next = 0;
+    ///containers being filled in exact size mode and their capacity
+    std::vector<std::pair<PNode, std::size_t> > _pending;
+    bool _exact = false;
+    void calc_exact_sizes(const StructuralIndex &index);
     void pop_container();
 
 
@@ -186,34 +476,81 @@ protected:
     }
 
     void throw_parse_error(Error err);
-    bool finish_value(Value x);
+    void throw_utf8_error(std::ptrdiff_t adjust);
+    void validate_run(const char *iter, const char *end, bool closed = false);
+    bool finish_value(PNode &&x);
+    PNode new_string(const std::string_view &str, bool in_situ);
+    bool finish_event();
+    bool finish_string();
+    bool finish_keyword();
+    bool finish_number_value();
     void append_unicode(int chr);
     bool finish_container();
     bool next(char c);
+    bool consume_char(char c);
     bool finish_number(char c);
+    const char *skip_white(const char *iter, const char *end);
+    const char *copy_string_run(const char *iter, const char *end);
+    const char *find_string_stop(const char *iter, const char *end);
+    const char *copy_digit_run(const char *iter, const char *end);
+    static const char *scan_number(const char *iter, const char *end);
+    static bool is_white(char c);
+    static bool accepts_white(State st);
+    static bool is_digit(char c);
+    static bool has_leading_zero(std::string_view num);
     static bool is_trail_surogate(int chr);
     static bool is_lead_surrogate(int chr);
     static int calc_surrogate(int lead, int trail);
 
+    void track_chars(std::size_t n) {
+        if constexpr(Policy::track_position) _chcnt += n;
+    }
+
 };
 
+using Parser = BasicParser<DefaultParserPolicy>;
+using StrictParser = BasicParser<StrictParserPolicy>;
+using ValidatingParser = BasicParser<ValidatingParserPolicy>;
+using ExtendedParser = BasicParser<ExtendedParserPolicy>;
+
+
+template<typename Policy>
+inline bool BasicParser<Policy>::put_char(char c) {
+    if (_arena) {
+        NodeArena::Scope _(_arena);
+        return consume_char(c);
+    }
+    return consume_char(c);
+}
 
-inline bool Parser::put_char(char c) {
-    ++_chcnt;
-    if (c == '\n') {
-        ++_line;
-        _begline = _chcnt;
+template<typename Policy>
+inline bool BasicParser<Policy>::consume_char(char c) {
+    if constexpr(Policy::track_position) {
+        ++_chcnt;
+        if (c == '\n') {
+            ++_line;
+            _begline = _chcnt;
+        }
     }
     return next(c);
 }
-inline bool Parser::next(char c) { // @suppress("No return")
+template<typename Policy>
+inline bool BasicParser<Policy>::next(char c) { // @suppress("No return")
+
+    if constexpr(Policy::allow_comments) {
+        if (c == '/' && accepts_white(_state)) {
+            _comment_ret = _state;
+            _state = State::comment_begin;
+            return true;
+        }
+    }
 
     switch(_state) {
         default:
         case State::ready: return false;
 
         case State::detect_type:
-            if (isspace(c)) return true;
+            if (Policy::is_space(c)) return true;
             switch (c) {
             case 'n':
                 check_kw("null",nullptr);
@@ -225,6 +562,7 @@ inline bool Parser::next(char c) { // @suppress("No return")
                 check_kw("false",false);
                 return next(c);
             case 'u':
+                if constexpr(!Policy::allow_undefined) throw_parse_error(Error::unexpected_character);
                 check_kw("undefined",Value());
                 return next(c);
             case '[':
@@ -241,13 +579,18 @@ inline bool Parser::next(char c) { // @suppress("No return")
                 _state = State::parse_string;
                 return true;
             case '+':
+                if constexpr(!Policy::allow_plus_sign) throw_parse_error(Error::unexpected_character);
+                push_string();
+                _strbuff.push_back(c);
+                _state = State::parse_number_digit;
+                return true;
             case '-':
                 push_string();
                 _strbuff.push_back(c);
                 _state = State::parse_number_digit;
                 return true;
             default:
-                if (isdigit(c)) {
+                if (is_digit(c)) {
                     push_string();
                     _state = State::parse_number;
                     return next(c);
@@ -259,7 +602,7 @@ inline bool Parser::next(char c) { // @suppress("No return")
             break;
 
        case State::detect_type_or_close_array:
-           if (std::isspace(c)) {
+           if (Policy::is_space(c)) {
                return true;
            } else if (c == ']') {
                return finish_container();
@@ -269,7 +612,7 @@ inline bool Parser::next(char c) { // @suppress("No return")
            }
 
        case State::parse_key:
-           if (std::isspace(c)) {
+           if (Policy::is_space(c)) {
                return true;
            }
            else if (c == '\"') {
@@ -284,7 +627,7 @@ inline bool Parser::next(char c) { // @suppress("No return")
            break;
 
        case State::parse_key_or_close_object:
-           if (std::isspace(c)) {
+           if (Policy::is_space(c)) {
                return true;
            } else if (c == '}') {
                return finish_container();
@@ -294,6 +637,9 @@ inline bool Parser::next(char c) { // @suppress("No return")
            }
 
        case State::parse_string:
+           if constexpr(Policy::validate_utf8) {
+               if (!_utf8.step(c)) throw_utf8_error(0);
+           }
            if (c =='\\') {
                _state = State::parse_string_escape;
                return true;
@@ -301,13 +647,18 @@ inline bool Parser::next(char c) { // @suppress("No return")
                if (_string_is_key) {
                    _string_is_key = false;
                    _state = State::colon;
+                   if (_handler) {
+                       _handler->key(top_string());
+                       pop_string();
+                   }
                    return true;
                } else {
-                    Value x (top_string());
-                    pop_string();
-                    return finish_value(x);
+                   return finish_string();
                }
            } else {
+               if constexpr(!Policy::allow_control_characters) {
+                   if (static_cast<unsigned char>(c) < 0x20) throw_parse_error(Error::unexpected_character);
+               }
                _strbuff.push_back(c);
                return true;
            }
@@ -317,7 +668,7 @@ inline bool Parser::next(char c) { // @suppress("No return")
            if (c == *_kw) {
                ++_kw;
                if (*_kw) return true;
-               else return finish_value(_kwval);
+               else return finish_keyword();
            } else {
                throw_parse_error(Error::unknown_keyword);
                break;
@@ -345,7 +696,7 @@ inline bool Parser::next(char c) { // @suppress("No return")
        case State::parse_string_escape_hex2:
        case State::parse_string_escape_hex3:
        case State::parse_string_escape_hex4:
-           c = std::toupper(c);
+           if (c >= 'a' && c <= 'f') c -= 'a' - 'A';
            if (c >= '0' && c <= '9') _unicode_chr = (_unicode_chr<<4) | (c - '0');
            else if (c >= 'A' && c<= 'F') _unicode_chr = (_unicode_chr<<4) | (c - 'A' + 10);
            else throw_parse_error(Error::invalid_unicode_hex_character);
@@ -389,7 +740,7 @@ inline bool Parser::next(char c) { // @suppress("No return")
            return true;
 
        case State::parse_number:
-           if (isdigit(c)) {
+           if (is_digit(c)) {
                _strbuff.push_back(c);
            }
            else if (c == '.') {
@@ -404,7 +755,7 @@ inline bool Parser::next(char c) { // @suppress("No return")
            return true;
 
        case State::parse_number_digit:
-           if (std::isdigit(c)) {
+           if (is_digit(c)) {
                _strbuff.push_back(c);
                _state = State::parse_number;
                return true;
@@ -414,7 +765,7 @@ inline bool Parser::next(char c) { // @suppress("No return")
            }
 
        case State::parse_number_decimal_digit:
-           if (std::isdigit(c)) {
+           if (is_digit(c)) {
                _strbuff.push_back(c);
                _state = State::parse_number_decimal;
                return true;
@@ -424,7 +775,7 @@ inline bool Parser::next(char c) { // @suppress("No return")
            }
 
        case State::parse_number_exponent_digit:
-           if (std::isdigit(c)) {
+           if (is_digit(c)) {
                _strbuff.push_back(c);
                _state = State::parse_number_exponent_digit2;
                return true;
@@ -435,7 +786,7 @@ inline bool Parser::next(char c) { // @suppress("No return")
 
 
        case State::parse_number_decimal:
-           if (isdigit(c)) {
+           if (is_digit(c)) {
                _strbuff.push_back(c);
            }
            else if (c == 'e' || c == 'E') {
@@ -456,7 +807,7 @@ inline bool Parser::next(char c) { // @suppress("No return")
            return next(c);
 
        case State::parse_number_exponent_digit2:
-           if (isdigit(c)) {
+           if (is_digit(c)) {
                _strbuff.push_back(c);
                return true;
            }
@@ -465,10 +816,10 @@ inline bool Parser::next(char c) { // @suppress("No return")
            }
 
        case State::close_array:
-           if (std::isspace(c)) {
+           if (Policy::is_space(c)) {
                return true;
            } else if (c == ',') {
-               _state = State::detect_type;
+               _state = Policy::allow_trailing_commas?State::detect_type_or_close_array:State::detect_type;
                return true;
            } else if (c == ']') {
                return finish_container();
@@ -478,10 +829,10 @@ inline bool Parser::next(char c) { // @suppress("No return")
            }
 
        case State::close_object:
-           if (std::isspace(c)) {
+           if (Policy::is_space(c)) {
                return true;
            } else if (c == ',') {
-               _state = State::parse_key;
+               _state = Policy::allow_trailing_commas?State::parse_key_or_close_object:State::parse_key;
                return true;
            } else if (c == '}') {
                return finish_container();
@@ -490,8 +841,24 @@ inline bool Parser::next(char c) { // @suppress("No return")
                break;
            }
 
+       case State::comment_begin:
+           if (c == '/') _state = State::comment_line;
+           else if (c == '*') _state = State::comment_block;
+           else throw_parse_error(Error::unexpected_character);
+           return true;
+       case State::comment_line:
+           if (c == '\n') _state = _comment_ret;
+           return true;
+       case State::comment_block:
+           if (c == '*') _state = State::comment_block_end;
+           return true;
+       case State::comment_block_end:
+           if (c == '/') _state = _comment_ret;
+           else if (c != '*') _state = State::comment_block;
+           return true;
+
        case State::colon: {
-           if (isspace(c)) return true;
+           if (Policy::is_space(c)) return true;
            if (c == ':') {
                _state = State::detect_type;
                return true;
@@ -506,29 +873,127 @@ inline bool Parser::next(char c) { // @suppress("No return")
 
 
 
-inline bool Parser::finish_value(Value x) {
+template<typename Policy>
+inline bool BasicParser<Policy>::finish_value(PNode &&x) {
     if (_items.empty()) {
-        _result = x;
+        _result = Value(std::move(x));
         _state = State::ready;
         return false;
     }
+    else if (_items.size() - 1 == _stream_level) {
+        _element_cb(Value(std::move(x)));
+        _state = State::close_array;
+        return true;
+    }
     else if (_items.back().second) {
-        _vstack.push_back(Value(top_string(), x));
+        std::string_view key = top_string();
+        if (key.empty()) push_item(std::move(x));
+        else if (_key_table) push_item(Node::new_key(key, std::move(x), *_key_table));
+        else push_item(Node::new_key(key, std::move(x)));
         pop_string();
         _state = State::close_object;
         return true;
     } else {
-        _vstack.push_back(x);
+        push_item(std::move(x));
         _state = State::close_array;
         return true;
     }
 }
 
-inline Value Parser::get_result() const {
+template<typename Policy>
+inline void BasicParser<Policy>::push_item(PNode &&item) {
+    if (_exact) {
+        auto &p = _pending.back();
+        //objects silently drop undefined members
+        if (_items.back().second && item->get_type() == ValueType::undefined) return;
+        if (p.first->size() >= p.second) {
+            //sizes don't match the structure of a malformed document, grow the container
+            //and let the state machine to report the error
+            std::size_t cap = std::max<std::size_t>(p.second * 2, 4);
+            PNode cont = Node::new_pending_container(p.first->get_type(), cap);
+            for (std::size_t i = 0, cnt = p.first->size(); i < cnt; ++i) {
+                Node::pending_push(cont, p.first->get(i));
+            }
+            p = {std::move(cont), cap};
+        }
+        Node::pending_push(p.first, std::move(item));
+    } else {
+        _vstack.push_back(std::move(item));
+    }
+}
+
+template<typename Policy>
+inline bool BasicParser<Policy>::finish_event() {
+    if (_items.empty()) {
+        _state = State::ready;
+        return false;
+    }
+    _state = _items.back().second?State::close_object:State::close_array;
+    return true;
+}
+
+template<typename Policy>
+inline bool BasicParser<Policy>::finish_string() {
+    if (_handler) {
+        _handler->string(top_string());
+        pop_string();
+        return finish_event();
+    }
+    PNode x = new_string(top_string(), false);
+    pop_string();
+    return finish_value(std::move(x));
+}
+
+template<typename Policy>
+inline PNode BasicParser<Policy>::new_string(const std::string_view &str, bool in_situ) {
+    auto create = [&] {
+        return in_situ?Node::new_string(str, StringType::utf8, _source_owner):Node::new_string(str, StringType::utf8);
+    };
+    if (_string_cache.empty() || str.size() > _string_cache_max_length) return create();
+    PNode &slot = _string_cache[std::hash<std::string_view>()(str) & (_string_cache.size()-1)];
+    if (slot == nullptr || slot->get_string() != str) {
+        //cached node survives reset(), so it must not keep arena's chunk or the source alive
+        NodeArena::Suspend _;
+        slot = Node::new_string(str, StringType::utf8);
+    }
+    return slot;
+}
+
+template<typename Policy>
+inline bool BasicParser<Policy>::finish_keyword() {
+    if (_handler) {
+        switch (_kwval.get_type()) {
+            case ValueType::null: _handler->null();break;
+            case ValueType::boolean: _handler->boolean(_kwval.get_bool());break;
+            default: _handler->undefined();break;
+        }
+        return finish_event();
+    }
+    return finish_value(PNode(_kwval.get_handle()));
+}
+
+template<typename Policy>
+inline bool BasicParser<Policy>::finish_number_value() {
+    if constexpr(!Policy::allow_leading_zeroes) {
+        if (has_leading_zero(top_string())) throw_parse_error(Error::invalid_number);
+    }
+    if (_handler) {
+        _handler->number(top_string());
+        pop_string();
+        return finish_event();
+    }
+    PNode x = Node::new_number(top_string());
+    pop_string();
+    return finish_value(std::move(x));
+}
+
+template<typename Policy>
+inline Value BasicParser<Policy>::get_result() const {
     return _result;
 }
 
-inline void Parser::append_unicode(int chr) {
+template<typename Policy>
+inline void BasicParser<Policy>::append_unicode(int chr) {
     if (chr < 128) {
         _strbuff.push_back(static_cast<char>(chr));
     }
@@ -549,73 +1014,162 @@ inline void Parser::append_unicode(int chr) {
     }
 }
 
-inline void Parser::push_string() {
+template<typename Policy>
+inline void BasicParser<Policy>::push_string() {
     _stritems.push_back(_strbuff.size());
 }
 
-inline std::string_view Parser::top_string() {
+template<typename Policy>
+inline std::string_view BasicParser<Policy>::top_string() {
     return std::string_view(_strbuff).substr(_stritems.back());
 }
 
-inline void Parser::pop_string() {
+template<typename Policy>
+inline void BasicParser<Policy>::pop_string() {
     _strbuff.resize(_stritems.back());
     _stritems.pop_back();
 }
 
-inline void Parser::push_container(bool is_object) {
+template<typename Policy>
+inline void BasicParser<Policy>::push_container(bool is_object) {
+    if (_exact) {
+        std::size_t sz = _exact_next < _exact_sizes.size()?_exact_sizes[_exact_next]:0;
+        ++_exact_next;
+        _pending.push_back({Node::new_pending_container(is_object?ValueType::object:ValueType::array, sz), sz});
+    }
+    if (_element_cb && !is_object && _stream_level == no_stream_level && match_stream_path()) {
+        _stream_level = _items.size();
+    }
     _items.push_back({_vstack.size(), is_object});
+    if (_handler) {
+        if (is_object) _handler->start_object(); else _handler->start_array();
+    }
+}
+
+template<typename Policy>
+inline bool BasicParser<Policy>::match_stream_path() const {
+    std::size_t depth = _items.size();
+    if (depth != _stream_path.size()) return false;
+    //keys of open objects are stored on the string stack in order of levels
+    auto key_iter = _stritems.begin();
+    for (std::size_t i = 0; i < depth; ++i) {
+        Value step = _stream_path[i];
+        if (_items[i].second) {
+            std::size_t b = *key_iter++;
+            std::size_t e = key_iter == _stritems.end()?_strbuff.size():*key_iter;
+            if (!step.is_string() || step.get_string() != std::string_view(_strbuff).substr(b, e - b)) return false;
+        } else {
+            std::size_t e = i+1 < depth?_items[i+1].first:_vstack.size();
+            if (!step.is_number() || step.get_unsigned_long() != e - _items[i].first) return false;
+        }
+    }
+    return true;
 }
 
-inline Value Parser::top_container() {
-    Range<decltype(_vstack)::const_iterator> r(_vstack.begin()+_items.back().first, _vstack.end());
+template<typename Policy>
+inline PNode BasicParser<Policy>::top_container() {
+    auto b = _vstack.begin()+_items.back().first;
+    auto e = _vstack.end();
+    std::size_t count = std::distance(b, e);
+    //items are moved to the container, the stack is truncated by pop_container()
     if (_items.back().second) {
-        return Object(r, [](const Value &v){return v;});
+        return Node::new_object(count, [&](ContBuilder &bld) {
+            for (auto iter = b; iter != e; ++iter) {
+                if ((*iter)->get_type() != ValueType::undefined) bld.push_back(std::move(*iter));
+            }
+            if (!std::is_sorted(bld.begin(), bld.end(), Node::KeyOrder())) {
+                std::sort(bld.begin(),bld.end(),Node::KeyOrder());
+            }
+        });
     } else {
-        return Array(r);
+        return Node::new_array(count, [&](ContBuilder &bld) {
+            for (auto iter = b; iter != e; ++iter) bld.push_back(std::move(*iter));
+        });
     }
 }
 
-inline void Parser::pop_container() {
-    _vstack.resize(_items.back().first);
+template<typename Policy>
+inline void BasicParser<Policy>::pop_container() {
+    _vstack.erase(_vstack.begin()+_items.back().first, _vstack.end());
     _items.pop_back();
 
 }
 
-inline void Parser::throw_parse_error(Error err) {
-    throw ParseError(err, _chcnt, _line+1, _chcnt-_begline-+1);
+template<typename Policy>
+inline void BasicParser<Policy>::throw_parse_error(Error err) {
+    if constexpr(Policy::track_position) {
+        throw ParseError(err, _chcnt, _line+1, _chcnt-_begline-+1);
+    } else {
+        //counters are not updated, report zero position
+        throw ParseError(err, 0, 0, 0);
+    }
 }
 
-inline bool Parser::finish_container() {
-    Value cont = top_container();
+template<typename Policy>
+inline void BasicParser<Policy>::throw_utf8_error(std::ptrdiff_t adjust) {
+    //report the first byte of the invalid sequence
+    if constexpr(Policy::track_position) _chcnt += adjust - _utf8.pending();
+    throw_parse_error(Error::invalid_utf8);
+}
+
+template<typename Policy>
+inline void BasicParser<Policy>::validate_run(const char *iter, const char *end, bool closed) {
+    if constexpr(Policy::validate_utf8) {
+        const char *bad = _utf8.validate(iter, end);
+        //string runs don't contain new lines, so line is not changed
+        if (bad) throw_utf8_error(bad - iter + 1);
+        //closing quote is consumed with the run
+        if (closed && !_utf8.complete()) throw_utf8_error(end - iter + 1);
+    }
+}
+
+template<typename Policy>
+inline bool BasicParser<Policy>::finish_container() {
+    if (_handler) {
+        bool is_object = _items.back().second;
+        _items.pop_back();
+        if (is_object) _handler->end_object(); else _handler->end_array();
+        return finish_event();
+    }
+    if (_items.size() - 1 == _stream_level) _stream_level = no_stream_level;
+    if (_exact) {
+        PNode cont = std::move(_pending.back().first);
+        _pending.pop_back();
+        _items.pop_back();
+        Node::pending_finish(cont);
+        return finish_value(std::move(cont));
+    }
+    PNode cont = top_container();
     pop_container();
-    bool res = finish_value(cont);
-    return res;
+    return finish_value(std::move(cont));
 }
 
-inline bool Parser::finish_number(char c) {
-    Value x(Node::new_number(top_string()));
-    pop_string();
-    finish_value(x);
+template<typename Policy>
+inline bool BasicParser<Policy>::finish_number(char c) {
+    finish_number_value();
     return next(c);
 }
 
-inline bool Parser::is_trail_surogate(int chr) {
+template<typename Policy>
+inline bool BasicParser<Policy>::is_trail_surogate(int chr) {
    return chr >= 0xDC00 && chr <= 0xDFFF;
 }
 
-inline bool Parser::is_lead_surrogate(int chr) {
+template<typename Policy>
+inline bool BasicParser<Policy>::is_lead_surrogate(int chr) {
    return chr >= 0xD800 && chr <= 0xDBFF;
 }
 
-inline void Parser::put_eof() {
+template<typename Policy>
+inline void BasicParser<Policy>::put_eof() {
+    NodeArena::Scope _(_arena);
     switch(_state) {
     case State::parse_number:
     case State::parse_number_decimal:
-    case State::parse_number_exponent_digit2: {
-            Value x(Node::new_number(top_string()));
-            pop_string();
-            finish_value(x);
-        }
+    case State::parse_number_exponent_digit2:
+        finish_number_value();
+        //number inside of unclosed container
+        if (_state != State::ready) throw_parse_error(Error::unexpected_end_of_file);
         break;
     default:
         throw_parse_error(Error::unexpected_end_of_file);
@@ -623,33 +1177,353 @@ inline void Parser::put_eof() {
     }
 }
 
-inline Value Parser::parse_string(const std::string_view &s)  {
-    Parser p;
-    for (auto c: s) {
-        if (!p.put_char(c)) return p.get_result();
+template<typename Policy>
+inline void BasicParser<Policy>::reset() {
+    auto release = [](auto &buff) {
+        if (buff.capacity() > max_retained_capacity) std::decay_t<decltype(buff)>().swap(buff);
+        else buff.clear();
+    };
+    _result = Value();
+    _state = State::detect_type;
+    _comment_ret = State::detect_type;
+    _string_is_key = false;
+    release(_vstack);
+    release(_items);
+    release(_strbuff);
+    release(_stritems);
+    release(_exact_sizes);
+    release(_pending);
+    _exact_next = 0;
+    _exact = false;
+    _index = nullptr;
+    _source_owner = nullptr;
+    _stream_level = no_stream_level;
+    _chcnt = _line = _begline = 0;
+    _utf8.reset();
+    _kw = nullptr;
+    _kwval = Value();
+    _unicode_chr = _trail_surrogate = _lead_surrogate = 0;
+}
+
+template<typename Policy>
+inline void BasicParser<Policy>::reset_all() {
+    reset();
+    _arena = nullptr;
+    _key_table = nullptr;
+    _handler = nullptr;
+    std::vector<PNode>().swap(_string_cache);
+    _string_cache_max_length = 0;
+    _element_cb = nullptr;
+    _stream_path = Value();
+}
+
+template<typename Policy>
+inline BasicParser<Policy>::Pooled::Pooled() {
+    auto &p = pool();
+    if (p.empty()) {
+        _p = std::make_unique<BasicParser>();
+    } else {
+        _p = std::move(p.back());
+        p.pop_back();
+    }
+}
+
+template<typename Policy>
+inline BasicParser<Policy>::Pooled::~Pooled() {
+    auto &p = pool();
+    //keep few parsers, more is needed only for nested parsing
+    if (p.size() < 4) {
+        //configuration must not leak to other users of the pool
+        _p->reset_all();
+        p.push_back(std::move(_p));
     }
-    p.put_eof();
+}
+
+template<typename Policy>
+inline std::vector<std::unique_ptr<BasicParser<Policy> > > &BasicParser<Policy>::Pooled::pool() {
+    static thread_local std::vector<std::unique_ptr<BasicParser> > p;
+    return p;
+}
+
+template<typename Policy>
+inline Value BasicParser<Policy>::parse_string(const std::string_view &s)  {
+    Pooled pp;
+    BasicParser &p = *pp;
+    p.parse_span(s.data(), s.data()+s.size());
+    if (p._state != State::ready) p.put_eof();
     return p.get_result();
 }
 
-inline std::pair<bool, std::string_view> Parser::parse_buffer(const std::string_view &s) {
-    if (_state == State::ready) return {false, s};
-    int ofs = 0;
-    for (auto c: s) {
-        ++ofs;
-        if (!put_char(c)) return {false, s.substr(ofs)};
+template<typename Policy>
+inline Value BasicParser<Policy>::parse_string(const StructuralIndex &index)  {
+    //the index doesn't know comments, quotes inside of comments would break it
+    if constexpr(Policy::allow_comments) return parse_string(index.text());
+    Pooled pp;
+    BasicParser &p = *pp;
+    std::string_view s = index.text();
+    p._index = &index;
+    p._index_iter = index.begin();
+    p.parse_span(s.data(), s.data()+s.size());
+    if (p._state != State::ready) p.put_eof();
+    return p.get_result();
+}
+
+template<typename Policy>
+inline Value BasicParser<Policy>::parse_exact(const StructuralIndex &index)  {
+    if constexpr(Policy::allow_comments) return parse_string(index.text());
+    Pooled pp;
+    BasicParser &p = *pp;
+    std::string_view s = index.text();
+    p._index = &index;
+    p._index_iter = index.begin();
+    p._exact = true;
+    p.calc_exact_sizes(index);
+    p.parse_span(s.data(), s.data()+s.size());
+    if (p._state != State::ready) p.put_eof();
+    return p.get_result();
+}
+
+template<typename Policy>
+inline void BasicParser<Policy>::calc_exact_sizes(const StructuralIndex &index) {
+    std::string_view text = index.text();
+    //for every open container: its ordinal number and count of commas
+    std::vector<std::pair<std::size_t, std::uint32_t> > stack;
+    for (std::uint32_t pos: index) {
+        switch (text[pos]) {
+            case '{':
+            case '[': {
+                std::size_t n = pos+1;
+                while (n < text.size() && is_white(text[n])) ++n;
+                bool empty = n < text.size() && (text[n] == ']' || text[n] == '}');
+                stack.push_back({_exact_sizes.size(), 0});
+                _exact_sizes.push_back(empty?0:1);
+            } break;
+            case ',':
+                if (!stack.empty()) ++stack.back().second;
+                break;
+            case '}':
+            case ']':
+                if (!stack.empty()) {
+                    auto &sz = _exact_sizes[stack.back().first];
+                    if (sz) sz += stack.back().second;
+                    stack.pop_back();
+                }
+                break;
+            default:
+                break;
+        }
     }
+}
+
+template<typename Policy>
+inline Value BasicParser<Policy>::parse_in_situ(const std::string_view &text, const Value &owner) {
+    Pooled pp;
+    BasicParser &p = *pp;
+    p._source_owner = owner.get_handle()->unset_key();
+    p.parse_span(text.data(), text.data()+text.size());
+    if (p._state != State::ready) p.put_eof();
+    return p.get_result();
+}
+
+template<typename Policy>
+inline std::pair<bool, std::string_view> BasicParser<Policy>::parse_buffer(const std::string_view &s) {
+    if (_state == State::ready) return {false, s};
+    const char *iter = parse_span(s.data(), s.data()+s.size());
+    if (_state == State::ready) return {false, s.substr(iter - s.data())};
     return {true, std::string_view()};
 }
 
-inline int Parser::calc_surrogate(int lead, int trail) {
+template<typename Policy>
+inline const char *BasicParser<Policy>::parse_span(const char *iter, const char *end) {
+    NodeArena::Scope _(_arena);
+    while (iter != end) {
+        switch (_state) {
+            case State::ready:
+                return iter;
+            case State::detect_type:
+            case State::detect_type_or_close_array:
+                iter = skip_white(iter, end);
+                if (iter != end && (is_digit(*iter) || *iter == '-' || (Policy::allow_plus_sign && *iter == '+'))) {
+                    //complete numbers are created directly from the input, (in-situ: referenced)
+                    const char *tkend = scan_number(iter, end);
+                    if (tkend) {
+                        std::string_view num(iter, tkend - iter);
+                        track_chars(tkend - iter);
+                        iter = tkend;
+                        bool cont;
+                        if (_handler) {
+                            _handler->number(num);
+                            cont = finish_event();
+                        } else {
+                            cont = finish_value(_source_owner != nullptr
+                                    ?Node::new_number(num, _source_owner)
+                                    :Node::new_number(num));
+                        }
+                        //character which terminated the number is consumed with the number
+                        if (!cont) {
+                            consume_char(*iter++);
+                            return iter;
+                        }
+                        continue;
+                    }
+                }
+                break;
+            case State::parse_key:
+            case State::parse_key_or_close_object:
+            case State::close_array:
+            case State::close_object:
+            case State::colon:
+                iter = skip_white(iter, end);
+                break;
+            case State::parse_string:
+                if (_source_owner != nullptr && !_string_is_key && _stritems.back() == _strbuff.size()) {
+                    //string without escape sequences is referenced directly
+                    const char *stop = find_string_stop(iter, end);
+                    if (stop != end && *stop == '"') {
+                        validate_run(iter, stop, true);
+                        PNode x = new_string(std::string_view(iter, stop - iter), true);
+                        pop_string();
+                        track_chars(stop - iter + 1);
+                        iter = stop + 1;
+                        if (!finish_value(std::move(x))) return iter;
+                        continue;
+                    }
+                    validate_run(iter, stop);
+                    _strbuff.append(iter, stop);
+                    track_chars(stop - iter);
+                    iter = stop;
+                } else {
+                    iter = copy_string_run(iter, end);
+                }
+                break;
+            case State::parse_number:
+            case State::parse_number_decimal:
+            case State::parse_number_exponent_digit2:
+                iter = copy_digit_run(iter, end);
+                break;
+            default:
+                break;
+        }
+        //character which terminated the run is processed by the state machine
+        if (iter == end || !consume_char(*iter++)) break;
+    }
+    return iter;
+}
+
+template<typename Policy>
+inline const char *BasicParser<Policy>::skip_white(const char *iter, const char *end) {
+    while (iter != end && is_white(*iter)) {
+        if constexpr(Policy::track_position) {
+            ++_chcnt;
+            if (*iter == '\n') {
+                ++_line;
+                _begline = _chcnt;
+            }
+        }
+        ++iter;
+    }
+    return iter;
+}
+
+template<typename Policy>
+inline const char *BasicParser<Policy>::copy_string_run(const char *iter, const char *end) {
+    const char *run = find_string_stop(iter, end);
+    validate_run(iter, run);
+    _strbuff.append(iter, run);
+    track_chars(run - iter);
+    return run;
+}
+
+template<typename Policy>
+inline const char *BasicParser<Policy>::find_string_stop(const char *iter, const char *end) {
+    if (_index) {
+        //the index contains quotes, escapes and control characters inside of strings
+        const char *base = _index->text().data();
+        auto index_end = _index->end();
+        while (_index_iter != index_end && base + *_index_iter < iter) ++_index_iter;
+        return _index_iter == index_end?end:std::min(base + *_index_iter, end);
+    }
+    //control characters are left to the state machine, they can contain new line
+    return _simd::find_string_stop(iter, end);
+}
+
+template<typename Policy>
+inline const char *BasicParser<Policy>::copy_digit_run(const char *iter, const char *end) {
+    const char *run = _simd::find_non_digit(iter, end);
+    _strbuff.append(iter, run);
+    track_chars(run - iter);
+    return run;
+}
+
+template<typename Policy>
+inline const char *BasicParser<Policy>::scan_number(const char *iter, const char *end) {
+    //same grammar as the state machine: [+-]digits[.digits][(e|E)[+-]digits]
+    auto digits = [&] {
+        if (iter == end || !is_digit(*iter)) return false;
+        iter = _simd::find_non_digit(iter+1, end);
+        return true;
+    };
+    if ((Policy::allow_plus_sign && *iter == '+') || *iter == '-') ++iter;
+    //leading zeroes are reported by the state machine
+    if constexpr(!Policy::allow_leading_zeroes) {
+        if (iter != end && *iter == '0' && iter+1 != end && is_digit(iter[1])) return nullptr;
+    }
+    if (!digits()) return nullptr;
+    if (iter != end && *iter == '.') {
+        ++iter;
+        if (!digits()) return nullptr;
+    }
+    if (iter != end && (*iter == 'e' || *iter == 'E')) {
+        ++iter;
+        if (iter != end && (*iter == '+' || *iter == '-')) ++iter;
+        if (!digits()) return nullptr;
+    }
+    //number must be terminated, otherwise it can continue in next buffer
+    return iter == end?nullptr:iter;
+}
+
+template<typename Policy>
+inline bool BasicParser<Policy>::is_white(char c) {
+    //locale independent, only whitespaces allowed by JSON standard. Others are
+    //handled by the state machine
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+template<typename Policy>
+inline bool BasicParser<Policy>::accepts_white(State st) {
+    switch (st) {
+        case State::detect_type:
+        case State::detect_type_or_close_array:
+        case State::parse_key:
+        case State::parse_key_or_close_object:
+        case State::close_array:
+        case State::close_object:
+        case State::colon: return true;
+        default: return false;
+    }
+}
+
+template<typename Policy>
+inline bool BasicParser<Policy>::is_digit(char c) {
+    return static_cast<unsigned char>(c - '0') < 10;
+}
+
+template<typename Policy>
+inline bool BasicParser<Policy>::has_leading_zero(std::string_view num) {
+    if (!num.empty() && (num[0] == '-' || num[0] == '+')) num = num.substr(1);
+    return num.size() > 1 && num[0] == '0' && is_digit(num[1]);
+}
+
+template<typename Policy>
+inline int BasicParser<Policy>::calc_surrogate(int lead, int trail) {
    static constexpr int SURROGATE_OFFSET =  0x10000 - (0xD800 << 10) - 0xDC00;
    return (lead << 10) + trail + SURROGATE_OFFSET;
 }
 
 template<typename Fn>
 Value Value::parse(Fn &&fn) {
-    Parser p;
+    Parser::Pooled pp;
+    Parser &p = *pp;
     int i = fn();
     while (i != -1) {
         if (!p.put_char(static_cast<char>(i))) {
@@ -0,0 +1,606 @@
+/*
+ * simd.h
+ *
+ *  Created on: 16. 10. 2026
+ */
+
+#ifndef KISSJSON_SIMD_H_
+#define KISSJSON_SIMD_H_
+
+#include <cstdint>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define KISSJSON_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+/*
+ * Low level kernels used by the parser to classify characters in blocks.
+ *
+ * The library is header only and it is compiled without any special compiler flags, so
+ * vectorized variants are compiled with the 'target' attribute and selected at runtime
+ * by the detected instruction set. Every kernel has also scalar variant, which
+ * is used on other platforms.
+ */
+
+namespace kjson {
+
+namespace _simd {
+
+///Instruction sets recognized by the library
+enum class Isa {
+    scalar,
+    sse42,
+    avx2
+};
+
+///Detects best available instruction set (result is cached)
+inline Isa detect_isa() {
+    static Isa isa = [] {
+#ifdef KISSJSON_SIMD_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return Isa::avx2;
+        if (__builtin_cpu_supports("sse4.2")) return Isa::sse42;
+#endif
+        return Isa::scalar;
+    }();
+    return isa;
+}
+
+///Size of block processed by block classifiers
+static constexpr std::size_t block_size = 64;
+
+///Classification of 64-byte block. Each bit represents one character
+struct BlockMasks {
+    ///quotes
+    std::uint64_t quote;
+    ///backslashes
+    std::uint64_t backslash;
+    ///structural characters {}[]:,
+    std::uint64_t op;
+    ///control characters (below 32)
+    std::uint64_t ctrl;
+};
+
+inline void classify_block_scalar(const char *p, BlockMasks &m) {
+    m = BlockMasks{0,0,0,0};
+    for (std::size_t i = 0; i < block_size; ++i) {
+        std::uint64_t bit = std::uint64_t(1) << i;
+        unsigned char c = static_cast<unsigned char>(p[i]);
+        switch (c) {
+            case '"': m.quote |= bit; break;
+            case '\\': m.backslash |= bit; break;
+            case '{':
+            case '}':
+            case '[':
+            case ']':
+            case ':':
+            case ',': m.op |= bit; break;
+            default: if (c < 0x20) m.ctrl |= bit;break;
+        }
+    }
+}
+
+#ifdef KISSJSON_SIMD_X86
+
+__attribute__((target("sse4.2")))
+inline void classify_block_sse42(const char *p, BlockMasks &m) {
+    const __m128i ops = _mm_setr_epi8('{','}','[',']',':',',',0,0,0,0,0,0,0,0,0,0);
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i ctrl = _mm_set1_epi8(0x1F);
+    m = BlockMasks{0,0,0,0};
+    for (std::size_t i = 0; i < block_size; i+=16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p+i));
+        auto q = static_cast<std::uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, quote)));
+        auto b = static_cast<std::uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, backslash)));
+        auto c = static_cast<std::uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(x, ctrl), x)));
+        auto o = static_cast<std::uint16_t>(_mm_cvtsi128_si32(_mm_cmpestrm(ops, 6, x, 16,
+                _SIDD_UBYTE_OPS|_SIDD_CMP_EQUAL_ANY|_SIDD_BIT_MASK)));
+        m.quote |= std::uint64_t(q) << i;
+        m.backslash |= std::uint64_t(b) << i;
+        m.op |= std::uint64_t(o) << i;
+        m.ctrl |= std::uint64_t(c) << i;
+    }
+}
+
+__attribute__((target("avx2")))
+inline void classify_block_avx2(const char *p, BlockMasks &m) {
+    m = BlockMasks{0,0,0,0};
+    for (std::size_t i = 0; i < block_size; i+=32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p+i));
+        __m256i o = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8('}'))),
+                _mm256_or_si256(
+                    _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('[')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8(']'))),
+                    _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(':')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8(',')))));
+        __m256i q = _mm256_cmpeq_epi8(x, _mm256_set1_epi8('"'));
+        __m256i b = _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\\'));
+        __m256i c = _mm256_cmpeq_epi8(_mm256_min_epu8(x, _mm256_set1_epi8(0x1F)), x);
+        m.quote |= std::uint64_t(static_cast<std::uint32_t>(_mm256_movemask_epi8(q))) << i;
+        m.backslash |= std::uint64_t(static_cast<std::uint32_t>(_mm256_movemask_epi8(b))) << i;
+        m.op |= std::uint64_t(static_cast<std::uint32_t>(_mm256_movemask_epi8(o))) << i;
+        m.ctrl |= std::uint64_t(static_cast<std::uint32_t>(_mm256_movemask_epi8(c))) << i;
+    }
+}
+
+#endif
+
+///Classify 64-byte block using given instruction set
+inline void classify_block(const char *p, BlockMasks &m, Isa isa) {
+    switch (isa) {
+#ifdef KISSJSON_SIMD_X86
+        case Isa::avx2: classify_block_avx2(p, m); break;
+        case Isa::sse42: classify_block_sse42(p, m); break;
+#endif
+        default: classify_block_scalar(p, m); break;
+    }
+}
+
+///Count trailing zeroes, x must not be zero
+inline int ctz(std::uint64_t x) {
+#ifdef __GNUC__
+    return __builtin_ctzll(x);
+#else
+    int r = 0;
+    while ((x & 1) == 0) {x >>= 1; ++r;}
+    return r;
+#endif
+}
+
+///Returns true if the character terminates run of string content (quote, backslash, control character)
+inline bool is_string_stop(char c) {
+    return c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20;
+}
+
+///Finds first quote, backslash or control character, processes 8 bytes at once
+inline const char *find_string_stop_scalar(const char *iter, const char *end) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    constexpr std::uint64_t ones = 0x0101010101010101ULL;
+    constexpr std::uint64_t high = 0x8080808080808080ULL;
+    while (end - iter >= 8) {
+        std::uint64_t x;
+        std::memcpy(&x, iter, 8);
+        std::uint64_t q = x ^ (ones * '"');
+        std::uint64_t b = x ^ (ones * '\\');
+        //lowest set bit is always exact, higher bits can be false positives
+        std::uint64_t m = ((q - ones) & ~q) | ((b - ones) & ~b) | ((x - ones * 0x20) & ~x);
+        m &= high;
+        if (m) return iter + ctz(m) / 8;
+        iter += 8;
+    }
+#endif
+    while (iter != end && !is_string_stop(*iter)) ++iter;
+    return iter;
+}
+
+#ifdef KISSJSON_SIMD_X86
+
+__attribute__((target("sse4.2")))
+inline const char *find_string_stop_sse42(const char *iter, const char *end) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i ctrl = _mm_set1_epi8(0x1F);
+    while (end - iter >= 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(iter));
+        __m128i r = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, quote), _mm_cmpeq_epi8(x, backslash)),
+                                 _mm_cmpeq_epi8(_mm_min_epu8(x, ctrl), x));
+        int m = _mm_movemask_epi8(r);
+        if (m) return iter + ctz(static_cast<std::uint64_t>(m));
+        iter += 16;
+    }
+    return find_string_stop_scalar(iter, end);
+}
+
+__attribute__((target("avx2")))
+inline const char *find_string_stop_avx2(const char *iter, const char *end) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i ctrl = _mm256_set1_epi8(0x1F);
+    while (end - iter >= 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(iter));
+        __m256i r = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(x, quote), _mm256_cmpeq_epi8(x, backslash)),
+                                    _mm256_cmpeq_epi8(_mm256_min_epu8(x, ctrl), x));
+        auto m = static_cast<std::uint32_t>(_mm256_movemask_epi8(r));
+        if (m) return iter + ctz(m);
+        iter += 32;
+    }
+    return find_string_stop_sse42(iter, end);
+}
+
+#endif
+
+///Finds first quote, backslash or control character in the range
+/**
+ * @param iter begin of range
+ * @param end end of range
+ * @param isa instruction set
+ * @return pointer to found character, or end
+ */
+inline const char *find_string_stop(const char *iter, const char *end, Isa isa = detect_isa()) {
+    switch (isa) {
+#ifdef KISSJSON_SIMD_X86
+        case Isa::avx2: return find_string_stop_avx2(iter, end);
+        case Isa::sse42: return find_string_stop_sse42(iter, end);
+#endif
+        default: return find_string_stop_scalar(iter, end);
+    }
+}
+
+///Returns true if the character is a decimal digit
+inline bool is_digit(char c) {
+    return static_cast<unsigned char>(c - '0') < 10;
+}
+
+///Finds first character, which is not a decimal digit, processes 8 bytes at once
+inline const char *find_non_digit_scalar(const char *iter, const char *end) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    constexpr std::uint64_t ones = 0x0101010101010101ULL;
+    constexpr std::uint64_t high = 0x8080808080808080ULL;
+    while (end - iter >= 8) {
+        std::uint64_t x;
+        std::memcpy(&x, iter, 8);
+        //high bit is set for bytes above '9' (add), below '0' (sub) or above 0x7F.
+        //lowest set bit is always exact, higher bits can be false positives
+        std::uint64_t m = (x | (x + ones * (0x80 - '9' - 1)) | (x - ones * '0')) & high;
+        if (m) return iter + ctz(m) / 8;
+        iter += 8;
+    }
+#endif
+    while (iter != end && is_digit(*iter)) ++iter;
+    return iter;
+}
+
+#ifdef KISSJSON_SIMD_X86
+
+__attribute__((target("sse4.2")))
+inline const char *find_non_digit_sse42(const char *iter, const char *end) {
+    const __m128i below = _mm_set1_epi8('0'-1);
+    const __m128i above = _mm_set1_epi8('9'+1);
+    while (end - iter >= 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(iter));
+        //signed compare, bytes above 0x7F are negative, so they are not digits
+        __m128i d = _mm_and_si128(_mm_cmpgt_epi8(x, below), _mm_cmpgt_epi8(above, x));
+        auto m = static_cast<std::uint16_t>(~_mm_movemask_epi8(d));
+        if (m) return iter + ctz(m);
+        iter += 16;
+    }
+    return find_non_digit_scalar(iter, end);
+}
+
+__attribute__((target("avx2")))
+inline const char *find_non_digit_avx2(const char *iter, const char *end) {
+    const __m256i below = _mm256_set1_epi8('0'-1);
+    const __m256i above = _mm256_set1_epi8('9'+1);
+    while (end - iter >= 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(iter));
+        __m256i d = _mm256_and_si256(_mm256_cmpgt_epi8(x, below), _mm256_cmpgt_epi8(above, x));
+        auto m = ~static_cast<std::uint32_t>(_mm256_movemask_epi8(d));
+        if (m) return iter + ctz(m);
+        iter += 32;
+    }
+    return find_non_digit_sse42(iter, end);
+}
+
+#endif
+
+///Finds first character, which is not a decimal digit
+/**
+ * @param iter begin of range
+ * @param end end of range
+ * @param isa instruction set
+ * @return pointer to found character, or end
+ */
+inline const char *find_non_digit(const char *iter, const char *end, Isa isa = detect_isa()) {
+    switch (isa) {
+#ifdef KISSJSON_SIMD_X86
+        case Isa::avx2: return find_non_digit_avx2(iter, end);
+        case Isa::sse42: return find_non_digit_sse42(iter, end);
+#endif
+        default: return find_non_digit_scalar(iter, end);
+    }
+}
+
+///Finds end of leading part of text, which is valid UTF-8 (scalar part)
+/**
+ * Scalar kernel doesn't validate, it is handled by Utf8Validator
+ * @return always begin of the range
+ */
+inline const char *utf8_valid_prefix_scalar(const char *iter, const char *) {
+    return iter;
+}
+
+///Moves end of validated range back to the first byte of incomplete sequence
+inline const char *utf8_back_to_boundary(const char *beg, const char *pos) {
+    for (int j = 1; j <= 3 && pos - j >= beg; ++j) {
+        unsigned char c = static_cast<unsigned char>(pos[-j]);
+        if (c < 0x80) break;
+        if (c >= 0xC0) {
+            int len = c >= 0xF0?4:c >= 0xE0?3:2;
+            if (len > j) return pos - j;
+            break;
+        }
+    }
+    return pos;
+}
+
+#ifdef KISSJSON_SIMD_X86
+
+/*
+ * UTF-8 validation - lookup algorithm (J. Keiser, D. Lemire: Validating UTF-8 In Less Than
+ * One Instruction Per Byte). Every pair of adjacent bytes is classified by three 4-bit
+ * table lookups, the results are combined and any remaining bit indicates an error.
+ * Three and four byte sequences are checked by looking two and three bytes back.
+ */
+
+namespace _utf8 {
+    static constexpr std::uint8_t too_short = 1<<0;
+    static constexpr std::uint8_t too_long = 1<<1;
+    static constexpr std::uint8_t overlong_3 = 1<<2;
+    static constexpr std::uint8_t too_large = 1<<3;
+    static constexpr std::uint8_t surrogate = 1<<4;
+    static constexpr std::uint8_t overlong_2 = 1<<5;
+    static constexpr std::uint8_t too_large_1000 = 1<<6;
+    static constexpr std::uint8_t overlong_4 = 1<<6;
+    static constexpr std::uint8_t two_conts = 1<<7;
+    static constexpr std::uint8_t carry = too_short | too_long | two_conts;
+
+    alignas(16) static constexpr std::uint8_t byte_1_high[16] = {
+        too_long, too_long, too_long, too_long, too_long, too_long, too_long, too_long,
+        two_conts, two_conts, two_conts, two_conts,
+        too_short | overlong_2,
+        too_short,
+        too_short | overlong_3 | surrogate,
+        too_short | too_large | too_large_1000 | overlong_4
+    };
+    alignas(16) static constexpr std::uint8_t byte_1_low[16] = {
+        carry | overlong_3 | overlong_2 | overlong_4,
+        carry | overlong_2,
+        carry,
+        carry,
+        carry | too_large,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000 | surrogate,
+        carry | too_large | too_large_1000,
+        carry | too_large | too_large_1000
+    };
+    alignas(16) static constexpr std::uint8_t byte_2_high[16] = {
+        too_short, too_short, too_short, too_short, too_short, too_short, too_short, too_short,
+        too_long | overlong_2 | two_conts | overlong_3 | too_large_1000 | overlong_4,
+        too_long | overlong_2 | two_conts | overlong_3 | too_large,
+        too_long | overlong_2 | two_conts | surrogate | too_large,
+        too_long | overlong_2 | two_conts | surrogate | too_large,
+        too_short, too_short, too_short, too_short
+    };
+}
+
+__attribute__((target("sse4.2")))
+inline __m128i utf8_check_sse42(__m128i x, __m128i prev) {
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    const __m128i t1h = _mm_load_si128(reinterpret_cast<const __m128i *>(_utf8::byte_1_high));
+    const __m128i t1l = _mm_load_si128(reinterpret_cast<const __m128i *>(_utf8::byte_1_low));
+    const __m128i t2h = _mm_load_si128(reinterpret_cast<const __m128i *>(_utf8::byte_2_high));
+    __m128i prev1 = _mm_alignr_epi8(x, prev, 15);
+    __m128i sc = _mm_and_si128(_mm_and_si128(
+            _mm_shuffle_epi8(t1h, _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble)),
+            _mm_shuffle_epi8(t1l, _mm_and_si128(prev1, nibble))),
+            _mm_shuffle_epi8(t2h, _mm_and_si128(_mm_srli_epi16(x, 4), nibble)));
+    __m128i prev2 = _mm_alignr_epi8(x, prev, 14);
+    __m128i prev3 = _mm_alignr_epi8(x, prev, 13);
+    __m128i must23 = _mm_or_si128(_mm_subs_epu8(prev2, _mm_set1_epi8(static_cast<char>(0xE0-0x80))),
+                                  _mm_subs_epu8(prev3, _mm_set1_epi8(static_cast<char>(0xF0-0x80))));
+    return _mm_xor_si128(_mm_and_si128(must23, _mm_set1_epi8(static_cast<char>(0x80))), sc);
+}
+
+__attribute__((target("sse4.2")))
+inline const char *utf8_valid_prefix_sse42(const char *iter, const char *end) {
+    const char *beg = iter;
+    __m128i prev = _mm_setzero_si128();
+    while (end - iter >= 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(iter));
+        __m128i err = utf8_check_sse42(x, prev);
+        if (!_mm_testz_si128(err, err)) return utf8_back_to_boundary(beg, iter);
+        prev = x;
+        iter += 16;
+    }
+    return utf8_back_to_boundary(beg, iter);
+}
+
+__attribute__((target("avx2")))
+inline __m256i utf8_check_avx2(__m256i x, __m256i prev) {
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i t1h = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i *>(_utf8::byte_1_high)));
+    const __m256i t1l = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i *>(_utf8::byte_1_low)));
+    const __m256i t2h = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i *>(_utf8::byte_2_high)));
+    __m256i shifted = _mm256_permute2x128_si256(prev, x, 0x21);
+    __m256i prev1 = _mm256_alignr_epi8(x, shifted, 15);
+    __m256i sc = _mm256_and_si256(_mm256_and_si256(
+            _mm256_shuffle_epi8(t1h, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+            _mm256_shuffle_epi8(t1l, _mm256_and_si256(prev1, nibble))),
+            _mm256_shuffle_epi8(t2h, _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble)));
+    __m256i prev2 = _mm256_alignr_epi8(x, shifted, 14);
+    __m256i prev3 = _mm256_alignr_epi8(x, shifted, 13);
+    __m256i must23 = _mm256_or_si256(_mm256_subs_epu8(prev2, _mm256_set1_epi8(static_cast<char>(0xE0-0x80))),
+                                     _mm256_subs_epu8(prev3, _mm256_set1_epi8(static_cast<char>(0xF0-0x80))));
+    return _mm256_xor_si256(_mm256_and_si256(must23, _mm256_set1_epi8(static_cast<char>(0x80))), sc);
+}
+
+__attribute__((target("avx2")))
+inline const char *utf8_valid_prefix_avx2(const char *iter, const char *end) {
+    const char *beg = iter;
+    __m256i prev = _mm256_setzero_si256();
+    __m256i err = _mm256_setzero_si256();
+    //errors are accumulated over 4 blocks, block with an error is then found by the scalar code
+    while (end - iter >= 128) {
+        for (int i = 0; i < 4; ++i) {
+            __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(iter + i*32));
+            err = _mm256_or_si256(err, utf8_check_avx2(x, prev));
+            prev = x;
+        }
+        if (!_mm256_testz_si256(err, err)) return utf8_back_to_boundary(beg, iter);
+        iter += 128;
+    }
+    while (end - iter >= 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(iter));
+        err = utf8_check_avx2(x, prev);
+        if (!_mm256_testz_si256(err, err)) return utf8_back_to_boundary(beg, iter);
+        prev = x;
+        iter += 32;
+    }
+    return utf8_back_to_boundary(beg, iter);
+}
+
+#endif
+
+///Finds end of leading part of text, which is valid UTF-8
+/**
+ * @param iter begin of range, it must be at begin of a character
+ * @param end end of range
+ * @param isa instruction set
+ * @return pointer after the validated part. It is always at begin of a character. Note
+ * that the function can stop before an error, or sooner (the rest must be validated by
+ * the scalar code)
+ */
+inline const char *utf8_valid_prefix(const char *iter, const char *end, Isa isa = detect_isa()) {
+    switch (isa) {
+#ifdef KISSJSON_SIMD_X86
+        case Isa::avx2: return utf8_valid_prefix_avx2(iter, end);
+        case Isa::sse42: return utf8_valid_prefix_sse42(iter, end);
+#endif
+        default: return utf8_valid_prefix_scalar(iter, end);
+    }
+}
+
+///Streaming UTF-8 validator
+/**
+ * Validates text passed in parts. Sequences can be split between parts. Rejects
+ * overlong encodings, surrogates and code points above U+10FFFF
+ */
+class Utf8Validator {
+public:
+
+    ///Validate one character (byte)
+    /**
+     * @param c byte
+     * @retval true valid so far
+     * @retval false invalid. The first invalid byte is pending() bytes before this byte
+     */
+    bool step(char c) {
+        unsigned char b = static_cast<unsigned char>(c);
+        if (_need) {
+            if (b < _lo || b > _hi) return false;
+            --_need;
+            _lo = 0x80;
+            _hi = 0xBF;
+            _seq = _need?_seq+1:0;
+            return true;
+        }
+        if (b < 0x80) return true;
+        if (b < 0xC2) return false;
+        if (b < 0xE0) {start(1, 0x80, 0xBF);}
+        else if (b == 0xE0) {start(2, 0xA0, 0xBF);}
+        else if (b == 0xED) {start(2, 0x80, 0x9F);}
+        else if (b < 0xF0) {start(2, 0x80, 0xBF);}
+        else if (b == 0xF0) {start(3, 0x90, 0xBF);}
+        else if (b < 0xF4) {start(3, 0x80, 0xBF);}
+        else if (b == 0xF4) {start(3, 0x80, 0x8F);}
+        else return false;
+        return true;
+    }
+
+    ///Validate part of text
+    /**
+     * @param iter begin of the part
+     * @param end end of the part
+     * @param isa instruction set
+     * @return nullptr if the part is valid (last sequence can be incomplete), otherwise
+     * pointer to byte where the error has been detected. The first invalid byte is
+     * pending() bytes before this byte
+     */
+    const char *validate(const char *iter, const char *end, Isa isa = detect_isa()) {
+        while (iter != end) {
+            if (_need == 0) iter = utf8_valid_prefix(iter, end, isa);
+            //vectorized code stops at block, which contains an error, or near to the end
+            const char *stop = end - iter > 64?iter+64:end;
+            while (iter != stop) {
+                if (!step(*iter)) return iter;
+                ++iter;
+            }
+        }
+        return nullptr;
+    }
+
+    ///Returns true, if the last sequence is complete
+    bool complete() const {return _need == 0;}
+    ///Count of bytes of incomplete sequence already processed
+    unsigned int pending() const {return _seq;}
+    ///Reset state
+    void reset() {_need = 0; _seq = 0;}
+
+protected:
+    unsigned char _need = 0;
+    unsigned char _lo = 0x80;
+    unsigned char _hi = 0xBF;
+    unsigned char _seq = 0;
+
+    void start(unsigned char need, unsigned char lo, unsigned char hi) {
+        _need = need;
+        _lo = lo;
+        _hi = hi;
+        _seq = 1;
+    }
+};
+
+///Computes inclusive prefix xor of bits (each bit is xor of all bits below including itself)
+inline std::uint64_t prefix_xor(std::uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+///Calculates mask of escaped characters
+/**
+ * @param backslash mask of backslashes
+ * @param carry in: true if first character of the block is escaped, out: same for the next block
+ * @return mask of escaped characters
+ */
+inline std::uint64_t find_escaped(std::uint64_t backslash, bool &carry) {
+    std::uint64_t escaped = 0;
+    if (carry) {
+        escaped = 1;
+        backslash &= ~std::uint64_t(1);
+    }
+    carry = false;
+    //backslashes are rare, so it is ok to process them one by one
+    while (backslash) {
+        int i = ctz(backslash);
+        if (i == 63) {
+            carry = true;
+            break;
+        }
+        std::uint64_t next = std::uint64_t(1) << (i+1);
+        escaped |= next;
+        backslash &= ~(next | (next >> 1));
+    }
+    return escaped;
+}
+
+}
+
+}
+
+
+
+#endif /* KISSJSON_SIMD_H_ */
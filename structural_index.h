@@ -0,0 +1,178 @@
+/*
+ * structural_index.h
+ *
+ *  Created on: 16. 10. 2026
+ */
+
+#ifndef KISSJSON_STRUCTURAL_INDEX_H_
+#define KISSJSON_STRUCTURAL_INDEX_H_
+
+#include "simd.h"
+#include <vector>
+#include <string_view>
+#include <stdexcept>
+
+namespace kjson {
+
+///Index of structural characters of a JSON text
+/**
+ * The index is built in one pass through the text (vectorized when the CPU supports it).
+ * It contains offsets of
+ *
+ * - all unescaped quotes
+ * - structural characters {}[]:, outside of strings
+ * - backslashes which starts an escape sequence inside of strings
+ * - control characters inside of strings
+ *
+ * It also contains bitmask of in-string regions. The parser uses the positions to jump
+ * over content of strings and to count items of containers (parse_exact). Whitespaces,
+ * numbers and keywords between the positions are still scanned by the parser itself.
+ * The in-string bitmask is not used by the parser, it is available to other tools
+ *
+ * @note The index only refers the text, the text must stay valid while the index is in use.
+ * Size of the text is limited to 4GB
+ */
+class StructuralIndex {
+public:
+
+    using Isa = _simd::Isa;
+
+    StructuralIndex() = default;
+    ///Build index for the text
+    explicit StructuralIndex(const std::string_view &text, Isa isa = _simd::detect_isa()) {
+        build(text, isa);
+    }
+
+    ///Build index for the text
+    /**
+     * @param text JSON text
+     * @param isa instruction set used to build the index. Default value selects
+     * the best available
+     */
+    void build(const std::string_view &text, Isa isa = _simd::detect_isa());
+
+    ///Retrieves indexed text
+    std::string_view text() const {return _text;}
+    ///Retrieves offsets of structural characters (ordered)
+    const std::vector<std::uint32_t> &positions() const {return _pos;}
+    ///Retrieves in-string bitmask, one bit per character (opening quote is included)
+    const std::vector<std::uint64_t> &string_mask() const {return _instr;}
+
+    ///Returns true, if the character at given offset is inside of a string
+    bool in_string(std::size_t offset) const {
+        return (_instr[offset/_simd::block_size] >> (offset % _simd::block_size)) & 1;
+    }
+
+    ///Scan structural characters {}[]:, outside of strings without building the index
+    /**
+     * @param text JSON text
+     * @param fn function called for every structural character. It receives offset
+     * and the character. It returns true to continue, or false to stop the scan
+     * @param isa instruction set
+     */
+    template<typename Fn>
+    static void scan(const std::string_view &text, Fn &&fn, Isa isa = _simd::detect_isa());
+
+    auto begin() const {return _pos.begin();}
+    auto end() const {return _pos.end();}
+    std::size_t size() const {return _pos.size();}
+
+protected:
+    ///Classified block of the text
+    struct Block {
+        ///offset of the first character of the block
+        std::size_t offset;
+        ///in-string bitmask
+        std::uint64_t in_string;
+        ///structural characters {}[]:, outside of strings
+        std::uint64_t op;
+        ///all characters stored to the index
+        std::uint64_t indexed;
+    };
+
+    ///Classifies the text block by block, escapes and strings are resolved
+    /**
+     * @param text JSON text
+     * @param fn function called for every block, returns false to stop
+     * @param isa instruction set
+     */
+    template<typename Fn>
+    static void scan_blocks(const std::string_view &text, Fn &&fn, Isa isa);
+
+    std::string_view _text;
+    std::vector<std::uint32_t> _pos;
+    std::vector<std::uint64_t> _instr;
+};
+
+inline void StructuralIndex::build(const std::string_view &text, Isa isa) {
+    if (text.size() > 0xFFFFFFFFULL) throw std::runtime_error("StructuralIndex: text is too large");
+    _text = text;
+    _pos.clear();
+    _instr.clear();
+    _pos.reserve(text.size()/8);
+    _instr.reserve(text.size()/_simd::block_size+1);
+
+    scan_blocks(text, [&](const Block &blk) {
+        _instr.push_back(blk.in_string);
+        std::uint64_t bits = blk.indexed;
+        while (bits) {
+            _pos.push_back(static_cast<std::uint32_t>(blk.offset + _simd::ctz(bits)));
+            bits &= bits - 1;
+        }
+        return true;
+    }, isa);
+}
+
+template<typename Fn>
+inline void StructuralIndex::scan(const std::string_view &text, Fn &&fn, Isa isa) {
+    const char *data = text.data();
+    scan_blocks(text, [&](const Block &blk) {
+        std::uint64_t bits = blk.op;
+        while (bits) {
+            std::size_t p = blk.offset + _simd::ctz(bits);
+            if (!fn(p, data[p])) return false;
+            bits &= bits - 1;
+        }
+        return true;
+    }, isa);
+}
+
+template<typename Fn>
+inline void StructuralIndex::scan_blocks(const std::string_view &text, Fn &&fn, Isa isa) {
+    bool escape_carry = false;
+    std::uint64_t prev_in_string = 0;
+    _simd::BlockMasks m;
+    const char *data = text.data();
+    std::size_t sz = text.size();
+
+    for (std::size_t ofs = 0; ofs < sz; ofs += _simd::block_size) {
+        if (sz - ofs >= _simd::block_size) {
+            _simd::classify_block(data+ofs, m, isa);
+        } else {
+            char buff[_simd::block_size];
+            std::memset(buff, ' ', sizeof(buff));
+            std::memcpy(buff, data+ofs, sz - ofs);
+            _simd::classify_block(buff, m, isa);
+        }
+        std::uint64_t escaped = _simd::find_escaped(m.backslash, escape_carry);
+        std::uint64_t quote = m.quote & ~escaped;
+        std::uint64_t in_string = _simd::prefix_xor(quote) ^ prev_in_string;
+        prev_in_string = static_cast<std::uint64_t>(static_cast<std::int64_t>(in_string) >> 63);
+
+        Block blk;
+        blk.offset = ofs;
+        blk.in_string = in_string;
+        blk.op = m.op & ~in_string;
+        blk.indexed = quote
+                | blk.op
+                | (m.backslash & ~escaped & in_string)
+                | (m.ctrl & in_string & ~quote);
+        if (!fn(blk)) return;
+    }
+}
+
+}
+
+
+
+#endif /* KISSJSON_STRUCTURAL_INDEX_H_ */
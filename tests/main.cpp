@@ -16,6 +16,8 @@
 #include "../value.h"
 #include "../serializer.h"
 #include "../parser.h"
+#include "../lazy.h"
+#include "../parallel.h"
 #include "../user_defined.h"
 
 #include <memory>
@@ -23,9 +25,13 @@
 
 #include "testClass.h"
 #include <random>
+#include <charconv>
 
 using namespace kjson;
 
+struct UntrackedParserPolicy: DefaultParserPolicy {
+	static constexpr bool track_position = false;
+};
 
 
 
@@ -290,7 +296,7 @@ int testMain(bool showOutput) {
 		out << o["aaa"].to_string();
 	};
 
-	tst.test("Array.create","[\"hi\",\"hola\",1,2,3,5,8,13,21,7.55794156398981e+27]") >> [](std::ostream &out){
+	tst.test("Array.create","[\"hi\",\"hola\",1,2,3,5,8,13,21,7.557941563989797e+27]") >> [](std::ostream &out){
 		Value a(Array{"hi","hola"});
 		a.append({1,2,3,5,8,13,21});
 		a.push(7557941563989796531369787923.2568971236);
@@ -303,6 +309,663 @@ int testMain(bool showOutput) {
         a.push(b);
         a.to_stream(out);
 	};
+	tst.test("Parse.buffer","[\"hello world\",123.25e+2,{\"a\":[true,null],\"key\\n\":-12}]") >> [](std::ostream &out) {
+		std::string_view src = "[\"hello world\" , 123.25e+2,\n {\"key\\n\":-12, \"a\":[true,null]}]";
+		Parser p;
+		std::pair<bool, std::string_view> r = {true, std::string_view()};
+		for (std::size_t i = 0; i < src.size() && r.first; i+=3) {
+			r = p.parse_buffer(src.substr(i,3));
+		}
+		p.get_result().to_stream(out);
+	};
+	tst.test("Parse.errorPosition","JSON Parse error: Unexpected character at offset 16 (line: 3 , column: 2)") >> [](std::ostream &out) {
+		try {
+			Value::from_string("[\"a b\",\n  2,\n  x]");
+		} catch (const ParseError &e) {
+			out << e.what();
+		}
+	};
+	tst.test("Parse.structuralIndex","ok") >> [](std::ostream &out) {
+		std::mt19937 rnd(1234);
+		const char *parts[] = {"\"text\"","\"a\\\\\"","\"\\\"q\\\"\"","\"[{:,}]\"","\"\\u0041\\n\"","\"ctrl\n\"","123.5",
+				"true","null","\"\\\\\\\\\\\"\\\\\""};
+		std::string json = "[";
+		for (int i = 0; i < 2000; i++) {
+			if (i) json.append(", ");
+			bool obj = rnd() % 4 == 0;
+			json.append(obj?"{\"k\\\"\":":"[");
+			json.append(parts[rnd() % (sizeof(parts)/sizeof(parts[0]))]);
+			json.append(obj?"}":"]");
+		}
+		json.append("]");
+		StructuralIndex a(json, StructuralIndex::Isa::scalar);
+		StructuralIndex b(json);
+		StructuralIndex c(json, StructuralIndex::Isa::sse42);
+		if (a.positions() != b.positions() || a.string_mask() != b.string_mask() || a.positions() != c.positions()) {
+			out << "index mismatch";
+			return;
+		}
+		std::string r1 = Value::from_string(json).to_string();
+		std::string r2 = Parser::parse_string(b).to_string();
+		out << (r1 == r2?"ok":"parse mismatch");
+	};
+	tst.test("Parse.longStrings","ok") >> [](std::ostream &out) {
+		std::mt19937 rnd(4321);
+		std::string data;
+		for (int i = 0; i < 4000; i++) {
+			int c = rnd() % 200;
+			data.push_back(c == 0?'"':c == 1?'\\':c == 2?'\t':static_cast<char>(c+32));
+		}
+		for (std::size_t i = 0; i < data.size(); i++) {
+			const char *b = data.data()+i;
+			const char *e = data.data()+data.size();
+			const char *r = _simd::find_string_stop(b, e, _simd::Isa::scalar);
+			if (r != _simd::find_string_stop(b, e, _simd::Isa::sse42) || r != _simd::find_string_stop(b, e)) {
+				out << "kernel mismatch at " << i;
+				return;
+			}
+		}
+		std::string text(1000,'x');
+		text[500] = '\t';
+		Value v(Array{text, "abc\"\\def", text.substr(100)});
+		std::string json = v.to_string();
+		Parser p;
+		for (std::size_t i = 0; i < json.size(); i += 77) p.parse_buffer(std::string_view(json).substr(i, 77));
+		out << (p.get_result() == v && Value::from_string(json) == v?"ok":"parse mismatch");
+	};
+	tst.test("Parse.inSitu","{\"a\":[1,-2.5e+3,\"text\",\"esc\\n\"],\"b\":0} 1 1 \" 0") >> [](std::ostream &out) {
+		Value v;
+		std::string_view a2, a3, a4;
+		{
+			Value src(std::string("{\"b\":0, \"a\":[1,-2.5e+3,\"text\",\"esc\\n\"]}"));
+			std::string_view txt = src.get_string();
+			v = Parser::parse_in_situ(src);
+			auto inside = [&](std::string_view s) {return s.data() >= txt.data() && s.data() < txt.data()+txt.size();};
+			out << v.to_string() << " " << inside(v["a"][1].get_string()) << " " << inside(v["a"][2].get_string())
+					<< " " << v["a"][2].get_string().data()[4] << " " << inside(v["a"][3].get_string());
+		}
+		//source is released, but it is still referenced by the nodes
+		if (v["a"][2].get_string() != "text") out << " released!";
+	};
+	tst.test("Parse.arena","ok 1 ok") >> [](std::ostream &out) {
+		std::size_t chunks = NodeArena::chunk_count();
+		std::string json = "{\"a\":[1,2,3,\"text\"],\"b\":{\"c\":true,\"d\":\"long string which does not fit into small node\"}}";
+		Value v;
+		{
+			NodeArena arena;
+			Parser p;
+			p.set_arena(&arena);
+			p.parse_buffer(json);
+			v = p.get_result();
+			out << (v == Value::from_string(json)?"ok":"mismatch") << " " << (NodeArena::chunk_count() - chunks);
+		}
+		//arena is destroyed, but nodes are still alive
+		Value b = v["b"];
+		v = Value();
+		out << " " << (b["d"].get_string() == "long string which does not fit into small node"?"ok":"corrupted");
+		b = Value();
+		if (NodeArena::chunk_count() != chunks) out << " leak!";
+	};
+	tst.test("Parse.lazy","3 42 [1,2,{\"x\":\"y\"}] 1 esc\"aped 3 a,b,c,esc\"key, 0 ok") >> [](std::ostream &out) {
+		LazyDocument doc("{\"a\":{\"skip\":[[1],{\"q\":\"]}\"}]},\"b\" : [10, 42 ,\"s\"],\n"
+				"\"c\":[1,2,{\"x\":\"y\"}],\"esc\\\"key\":true, \"d\":\"esc\\\"aped\"}");
+		LazyValue root = doc.root();
+		out << root["b"].size() << " " << root["b"][1].get_int() << " " << root["c"].get().to_string()
+				<< " " << root["esc\"key"].get_bool() << " " << root["d"].get_string()
+				<< " " << root["c"][2]["x"].get_text().size() << " ";
+		for (const LazyValue &v: root) {
+			if (v.get_key() == "d") break;
+			out << v.get_key() << ",";
+		}
+		out << " " << root["none"].defined();
+		Value full = Value::from_string(doc.text());
+		out << " " << (root["a"].get() == full["a"].strip_key()?"ok":"mismatch");
+	};
+	tst.test("Parse.lazyUndefined","1 1 0 1 b b, 1 3 3 1") >> [](std::ostream &out) {
+		LazyDocument doc("[{\"a\":undefined,\"b\":1,\"c\":undefined},undefined,{\"x\":undefined}]");
+		LazyValue obj = doc.root()[0];
+		Value full = Value::from_string(doc.text());
+		out << obj.size() << " " << full[0].size() << " " << obj["a"].defined() << " " << obj["b"].get_int() << " ";
+		out << obj[0].get_key() << " ";
+		for (const LazyValue &v: obj) out << v.get_key() << ",";
+		out << " " << doc.root()[2].empty() << " " << doc.root().size() << " " << full.size() << " ";
+		out << (doc.root()[1].get_type() == ValueType::undefined);
+	};
+	tst.test("Parse.lazyStrings","a\"b k\"y 12.50 true") >> [](std::ostream &out) {
+		LazyDocument doc("{\"s\":\"a\\\"b\",\"k\\\"y\":12.50,\"t\":true}");
+		std::string_view s = doc.root()["s"].get_string();
+		std::string_view k = doc.root()[1].get_key();
+		std::string_view n = doc.root()[1].get_string();
+		std::string_view t = doc.root()["t"].get_string();
+		out << s << " " << k << " " << n << " " << t;
+	};
+	tst.test("Parse.events","{ k:a [ n:1 n:-2.5e3 s:x\"y ] k:b { } k:c b:1 k:d z } 0") >> [](std::ostream &out) {
+		class Trace: public ParseHandler {
+		public:
+			Trace(std::ostream &out):out(out) {}
+			void start_object() override {out << "{ ";}
+			void end_object() override {out << "} ";}
+			void start_array() override {out << "[ ";}
+			void end_array() override {out << "] ";}
+			void key(std::string_view key) override {out << "k:" << key << " ";}
+			void string(std::string_view str) override {out << "s:" << str << " ";}
+			void number(std::string_view num) override {out << "n:" << num << " ";}
+			void boolean(bool b) override {out << "b:" << b << " ";}
+			void null() override {out << "z ";}
+			std::ostream &out;
+		};
+		Trace trace(out);
+		Parser p(trace);
+		std::string_view json = "{\"a\":[1, -2.5e3,\"x\\\"y\"], \"b\":{}, \"c\":true, \"d\":null}";
+		//feed the parser in small pieces, the event mode must be resumable too
+		for (std::size_t i = 0; i < json.size(); i += 3) p.parse_buffer(json.substr(i, 3));
+		out << p.get_result().defined();
+	};
+	tst.test("Parse.streamElements","1 {\"a\":[2,3]} \"x\" [] | 10 20 {\"other\":[1],\"res\":{\"items\":[]}}") >> [](std::ostream &out) {
+		Parser p;
+		p.stream_elements([&](const Value &v){out << v.to_string() << " ";});
+		std::string_view json = "[1, {\"a\":[2,3]}, \"x\"]";
+		for (std::size_t i = 0; i < json.size(); i += 4) p.parse_buffer(json.substr(i, 4));
+		out << p.get_result().to_string() << " | ";
+		Parser q;
+		q.stream_elements([&](const Value &v){out << v.to_string() << " ";}, Array{"res","items"});
+		q.parse_buffer("{\"other\":[1],\"res\":{\"items\":[10,20]}}");
+		out << q.get_result().to_string();
+	};
+	tst.test("Parse.ndjson","ok ok ok ok ok ") >> [](std::ostream &out) {
+		std::string ndjson, seq, concat;
+		std::vector<Value> expected;
+		for (int i = 0; i < 500; i++) {
+			Value v = i % 3 == 0?Value(i):i % 3 == 1?Value(Object{{"id",i},{"s","x\\\"}\n"}}):Value(Array{i,"]"});
+			expected.push_back(v);
+			std::string s = v.to_string();
+			ndjson.append(s).append("\n");
+			seq.append("\x1E").append(s).append("\n");
+			concat.append(s).append(i % 3 == 0?" ":"");
+		}
+		auto check = [&](NDJsonReader::Format fmt, NDJsonReader::Delivery dlv, auto &&input) {
+			NDJsonReader rd(fmt, dlv, 4);
+			rd.set_chunk_size(100);
+			std::vector<Value> res;
+			std::mutex mx;
+			rd.read(input, [&](const Value &v){std::lock_guard _(mx);res.push_back(v);});
+			if (dlv == NDJsonReader::Delivery::unordered) {
+				std::sort(res.begin(), res.end(), [](const Value &a, const Value &b){
+					return (a.is_object()?a["id"]:a.is_array()?a[0]:a).get_int() < (b.is_object()?b["id"]:b.is_array()?b[0]:b).get_int();
+				});
+			}
+			out << (res == expected?"ok ":"fail ");
+		};
+		check(NDJsonReader::Format::ndjson, NDJsonReader::Delivery::ordered, std::string_view(ndjson));
+		check(NDJsonReader::Format::ndjson, NDJsonReader::Delivery::unordered, std::string_view(ndjson));
+		check(NDJsonReader::Format::json_seq, NDJsonReader::Delivery::ordered, std::string_view(seq));
+		check(NDJsonReader::Format::concatenated, NDJsonReader::Delivery::ordered, std::string_view(concat));
+		std::istringstream in(ndjson);
+		check(NDJsonReader::Format::ndjson, NDJsonReader::Delivery::ordered, in);
+	};
+	tst.test("Parse.parallel","ok ok ok ok") >> [](std::ostream &out) {
+		WorkerPool pool(4);
+		Value arr(Array(2000, [](std::size_t i) -> Value {
+			return i % 2?Value(Object{{"i",static_cast<int>(i)},{"s","a,\\\"]}"}}):Value(Array{static_cast<int>(i),nullptr,true});
+		}));
+		Value obj(Object(500, [](std::size_t i) {return Value(std::to_string(i), Array{static_cast<int>(i),"x"});}));
+		for (const Value &v: {arr, obj}) {
+			std::string json = v.to_string();
+			out << (parse_parallel(json, pool, 100) == v?"ok ":"fail ");
+		}
+		std::string bad = arr.to_string();
+		bad.insert(bad.find(",[", bad.size()/2)+1, "x");
+		std::string seq_error, par_error;
+		try {Value::from_string(bad);} catch (const ParseError &e) {seq_error = e.what();}
+		try {parse_parallel(bad, pool, 100);} catch (const ParseError &e) {par_error = e.what();}
+		out << (!seq_error.empty() && seq_error == par_error?"ok ":par_error);
+		std::string trailing = "[" + std::string(400, ' ') + "1," + std::string(400, ' ') + "]";
+		try {parse_parallel(trailing, pool, 100);out << "accepted";} catch (const ParseError &e) {out << "ok";}
+	};
+	tst.test("Parse.parallelErrors","ok ok") >> [](std::ostream &out) {
+		WorkerPool pool(4);
+		std::string bad = Value(Array(2000, [](std::size_t i) {return Value(static_cast<int>(i));})).to_string();
+		for (std::size_t p = bad.size()/4; p < bad.size(); p += bad.size()/4) bad.insert(bad.find(',', p)+1, "x");
+		std::string seq_error;
+		try {Parser::parse_string(bad);} catch (const ParseError &e) {seq_error = e.what();}
+		bool same = true;
+		for (int i = 0; i < 20; i++) {
+			try {parse_parallel(bad, pool, 16);same = false;} catch (const ParseError &e) {same = same && seq_error == e.what();}
+		}
+		out << (same?"ok ":"fail ");
+		std::string utf = "\xC3\xA1" + std::string(100, ' ') + "[1]";
+		try {parse_parallel(utf, pool, 16);out << "accepted";} catch (const ParseError &) {out << "ok";}
+	};
+	tst.test("Parse.parallelRegions","ok") >> [](std::ostream &out) {
+		WorkerPool pool(4);
+		std::string doc = "{";
+		for (int i = 0; i < 200; i++) doc += "\"a" + std::to_string(i) + "\":" + (i % 50 < 40?"undefined":"false") + "\n,";
+		doc += "\"b\":false}";
+		out << (parse_parallel(doc, pool, 16) == Parser::parse_string(doc)?"ok":"fail");
+	};
+	tst.test("Parse.keyTable","ok 1 1 3 ok 1") >> [](std::ostream &out) {
+		KeyTable keys;
+		std::string json = "[{\"id\":1,\"name\":\"a\",\"tags\":[]},{\"tags\":[1],\"name\":\"b\",\"id\":2}]";
+		Parser p;
+		p.set_key_table(&keys);
+		p.parse_buffer(json);
+		Value v = p.get_result();
+		out << (v == Value::from_string(json)?"ok":"mismatch") << " "
+				<< (v[0]["name"].get_key().data() == v[1]["name"].get_key().data()) << " "
+				<< (v[1]["id"].get_int() == 2) << " " << keys.size() << " ";
+		Object o({{"name","c"},{"id",3}}, keys);
+		out << (o == Object{{"id",3},{"name","c"}}?"ok":"mismatch") << " "
+				<< (o["id"].get_key().data() == v[0]["id"].get_key().data());
+	};
+	tst.test("Parse.stringCache","ok 1 0 1") >> [](std::ostream &out) {
+		std::string json = "[\"OK\",\"eu-west-1\",\"OK\",\"a long string which is not cached\",\"a long string which is not cached\",\"eu-west-1\"]";
+		Parser p;
+		p.set_string_cache(64, 16);
+		p.parse_buffer(json);
+		Value v = p.get_result();
+		out << (v == Value::from_string(json)?"ok":"mismatch") << " "
+				<< (v[0].get_string().data() == v[2].get_string().data()) << " "
+				<< (v[3].get_string().data() == v[4].get_string().data()) << " "
+				<< (v[1].get_string().data() == v[5].get_string().data());
+	};
+	tst.test("Parse.stringCacheArena","ok 0 ok") >> [](std::ostream &out) {
+		std::size_t chunks = NodeArena::chunk_count();
+		Parser p;
+		p.set_string_cache(64);
+		{
+			NodeArena arena;
+			p.set_arena(&arena);
+			p.parse_buffer("[\"OK\",\"eu-west-1\",[\"OK\",1,2,3]]");
+			Value v = p.get_result();
+			out << (v[0].get_string().data() == v[2][0].get_string().data()?"ok":"not cached") << " ";
+			p.reset();
+			p.set_arena(nullptr);
+		}
+		//the arena and the document are gone, the cache must not keep the chunk alive
+		out << (NodeArena::chunk_count() - chunks) << " ";
+		p.parse_buffer("[\"OK\"]");
+		out << (p.get_result()[0].get_string() == "OK"?"ok":"corrupted");
+	};
+	tst.test("Parse.objectOrder","{\"\":4,\"a\":2,\"b\":1,\"d\":[3]} 2 [1,null]") >> [](std::ostream &out) {
+		Value v = Value::from_string("{\"b\":1,\"a\":2,\"c\":undefined,\"d\":[3],\"\":4}");
+		out << v.to_string() << " " << v["a"].get_int() << " " << Value::from_string("[1,null]").to_string();
+	};
+	tst.test("Parse.exactSize","ok ok ok") >> [](std::ostream &out) {
+		std::string docs[] = {
+			"{\"b\":[1,2,[],{},[[3],[4,5]]],\"a\":\"x,]}\\\",[\",\"c\":undefined, \"d\" : [ ] }",
+			"[ {\"k\":1,\"j\":[\"a\",\"b\"]} , 12.5e3 , true , null , \"\" ]",
+			"42"
+		};
+		for (const auto &d: docs) {
+			StructuralIndex index(d);
+			out << (Parser::parse_exact(index) == Value::from_string(d)?"ok":"mismatch") << (&d == docs+2?"":" ");
+		}
+	};
+	tst.test("Parse.truncatedNumber","12 eof eof eof") >> [](std::ostream &out) {
+		std::string docs[] = {"12", "[1,2", "{\"a\":1,\"b\":2", "[[1],-3.5e1"};
+		for (const auto &d: docs) {
+			try {
+				out << Parser::parse_string(d).to_string();
+			} catch (const ParseError &e) {
+				out << (e.get_error() == ParseError::Error::unexpected_end_of_file?"eof":e.what());
+			}
+			out << (&d == docs+3?"":" ");
+		}
+	};
+	tst.test("Parse.exactMalformed","ok ok ok ok") >> [](std::ostream &out) {
+		std::string docs[] = {"{\"a\":1,\"b\":2", "[1,2,[3,4]", "[[1,2,3]", "[1 2,3]"};
+		for (const auto &d: docs) {
+			std::string exact, seq;
+			try {Parser::parse_exact(StructuralIndex(d));} catch (const ParseError &e) {exact = e.what();}
+			try {Parser::parse_string(d);} catch (const ParseError &e) {seq = e.what();}
+			out << (!exact.empty() && exact == seq?"ok":exact) << (&d == docs+3?"":" ");
+		}
+	};
+	tst.test("Parse.reset","[1,{\"a\":\"b\"}] error {\"x\":[true]} \"ok\" 1") >> [](std::ostream &out) {
+		Parser p;
+		p.parse_buffer("[1,{\"a\":\"b\"}]");
+		out << p.get_result().to_string() << " ";
+		p.reset();
+		try {p.parse_buffer("{\"a\":+}");} catch (const ParseError &) {out << "error ";}
+		p.reset();
+		p.parse_buffer("{\"x\":[true]}");
+		out << p.get_result().to_string() << " ";
+		//pooled parser must be clean after an error
+		try {Value::from_string("[\"unterminated");} catch (const ParseError &) {}
+		out << Value::from_string("\"ok\"").to_string() << " ";
+		Parser::Pooled pp;
+		pp->parse_buffer("1 ");
+		out << pp->get_result().get_int();
+	};
+	tst.test("Parse.pooledConfig","[1,2,3] 0 {\"k\":\"a\"} 0") >> [](std::ostream &out){
+		int calls = 0;
+		KeyTable keys;
+		{
+			NodeArena arena;
+			Parser::Pooled pp;
+			pp->stream_elements([&](const Value &){++calls;});
+			pp->set_arena(&arena);
+			pp->set_key_table(&keys);
+			pp->set_string_cache(16);
+			pp->parse_buffer("[1,2,3]");
+			calls = 0;
+		}
+		out << Parser::parse_string("[1,2,3]").to_string() << " " << calls << " ";
+		out << Parser::parse_string("{\"k\":\"a\"}").to_string() << " ";
+		out << keys.size();
+	};
+	tst.test("Parse.policies","[1,2,{\"a\":3}] JSON Parse error: Unexpected character at offset 2 (line: 1 , column: 1) 1 [1,2]") >> [](std::ostream &out){
+		out << kjson::ExtendedParser::parse_string("[1, // first\n 2, /* second */ {\"a\":3,},]").to_string() << " ";
+		try {
+			kjson::StrictParser::parse_string("[undefined]");
+		} catch (const kjson::ParseError &e) {
+			out << e.what() << " ";
+		}
+		out << kjson::Parser::parse_string("[undefined]").size() << " ";
+		out << kjson::ExtendedParser::parse_string(kjson::StructuralIndex("[1,/*\"*/2]")).to_string();
+	};
+	tst.test("Parse.strictGrammar","0 0 5 5 5 0 0 0 [0,-0,0.5,1e+5,10,\"\\t\"] [+1,012,\"a\\tb\"]") >> [](std::ostream &out) {
+		std::string bad[] = {"+1", "[+1]", "[012]", "[-01]", "012", "\"a\tb\"", "[\"x\ny\"]", "{\"\x01\":1}"};
+		for (const auto &d: bad) {
+			try {
+				if (&d == bad+6) StrictParser::parse_string(StructuralIndex(d));
+				else StrictParser::parse_string(d);
+				out << "accepted ";
+			} catch (const ParseError &e) {
+				out << static_cast<int>(e.get_error()) << " ";
+			}
+		}
+		out << StrictParser::parse_string("[0,-0,0.5,1e+5,10,\"\\t\"]").to_string() << " ";
+		out << Parser::parse_string("[+1,012,\"a\tb\"]").to_string();
+	};
+	tst.test("Parse.untrackedPosition","0 0 0 0 0 0 [1,2]") >> [](std::ostream &out) {
+		for (const char *d: {"[1,\n2,x]", "{\"a\":\n\n[1,2"}) {
+			try {
+				BasicParser<UntrackedParserPolicy>::parse_string(d);
+			} catch (const ParseError &e) {
+				out << e.get_offset() << " " << e.get_line() << " " << e.get_column() << " ";
+			}
+		}
+		out << BasicParser<UntrackedParserPolicy>::parse_string("[1,2]").to_string();
+	};
+	tst.test("Parse.numberRuns","ok [1,-2.5e+3,12345678901234567890123,0.125,1e-7] 5") >> [](std::ostream &out) {
+		std::mt19937 rnd(1234);
+		std::string data;
+		for (int i = 0; i < 4000; i++) {
+			int c = rnd() % 24;
+			data.push_back(c < 20?static_cast<char>('0' + c % 10):static_cast<char>(rnd() % 256));
+		}
+		for (std::size_t i = 0; i < data.size(); i++) {
+			const char *b = data.data()+i;
+			const char *e = data.data()+data.size();
+			const char *r = _simd::find_non_digit(b, e, _simd::Isa::scalar);
+			if (r != _simd::find_non_digit(b, e, _simd::Isa::sse42) || r != _simd::find_non_digit(b, e)) {
+				out << "kernel mismatch at " << i;
+				return;
+			}
+		}
+		out << "ok ";
+		std::string json = "[1,-2.5e+3,12345678901234567890123,0.125,1e-7]";
+		Parser p;
+		for (std::size_t i = 0; i < json.size(); i += 5) p.parse_buffer(std::string_view(json).substr(i, 5));
+		Value v = p.get_result();
+		out << Value::from_string(json).to_string() << " " << (v == Value::from_string(json)?v.size():0);
+	};
+	tst.test("Parse.utf8","ok 1 5 5 17 1") >> [](std::ostream &out) {
+		std::mt19937 rnd(777);
+		const char *samples[] = {"a", "\xC5\xBE", "\xE2\x82\xAC", "\xF0\x9F\x98\x80", "\xED\x9F\xBF", "\xF4\x8F\xBF\xBF",
+				"\xC0\xAF", "\xED\xA0\x80", "\xF4\x90\x80\x80", "\x80", "\xE2\x82", "\xFF"};
+		for (int n = 0; n < 300; n++) {
+			std::string data;
+			int bad = rnd() % 3;
+			while (data.size() < 300) {
+				data.append(samples[bad?rnd() % 12:rnd() % 6]);
+			}
+			for (std::size_t i = 0; i < data.size(); i += 37) {
+				const char *b = data.data()+i;
+				const char *e = data.data()+data.size();
+				_simd::Utf8Validator v1, v2, v3;
+				const char *r = v1.validate(b, e, _simd::Isa::scalar);
+				if (r != v2.validate(b, e, _simd::Isa::sse42) || r != v3.validate(b, e)
+						|| v1.pending() != v2.pending() || v1.pending() != v3.pending()) {
+					out << "kernel mismatch at " << n << ":" << i;
+					return;
+				}
+			}
+		}
+		out << "ok ";
+		std::string text = "[\"p\xC5\x99\xC3\xADli\xC5\xA1 \xF0\x9F\x98\x80\"]";
+		out << (ValidatingParser::parse_string(text) == Parser::parse_string(text)) << " ";
+		auto err_offset = [](auto &&fn) -> std::size_t {
+			try {
+				fn();
+			} catch (const ParseError &e) {
+				if (e.get_error() == ParseError::Error::invalid_utf8) return e.get_offset();
+			}
+			return 0;
+		};
+		std::string bad = "[\"ab\xE2\x82x\"]";
+		out << err_offset([&]{ValidatingParser::parse_string(bad);}) << " ";
+		out << err_offset([&]{
+			ValidatingParser p;
+			for (char c: bad) p.put_char(c);
+		}) << " ";
+		std::string longbad = "[\"" + std::string(14, 'x') + "\xF0\x9F\x98\"]";
+		out << err_offset([&]{StrictParser::parse_in_situ(Value(longbad));}) << " ";
+		out << (Parser::parse_string(bad).size());
+	};
+	tst.test("Number.shortest","0.1 1e-3 0.015 12345678 1e+8 -2.5e-7 1e+300 5e-324 0.3 0.1 ok") >> [](std::ostream &out) {
+		for (double d: {0.1, 0.001, 0.015, 12345678.0, 1e8, -2.5e-7, 1e300, 5e-324, 0.3}) {
+			out << std::string_view(float_to_string(d)) << " ";
+		}
+		out << std::string_view(float_to_string(0.1f)) << " ";
+		std::mt19937_64 rnd(42);
+		auto check = [&](auto v) {
+			char buff[64];
+			auto r = std::to_chars(buff, buff+sizeof(buff), v, std::chars_format::scientific);
+			std::string_view ref(buff, r.ptr - buff);
+			auto epos = ref.find('e');
+			std::string digits;
+			for (char c: ref.substr(0, epos)) if (c != '.' && c != '-') digits.push_back(c);
+			int exp = std::atoi(std::string(ref.substr(epos+1)).c_str()) - static_cast<int>(digits.size()) + 1;
+			auto d = _details::to_shortest_decimal(std::abs(v));
+			return std::to_string(d.digits) == digits && d.exponent == exp;
+		};
+		for (int i = 0; i < 100000; i++) {
+			std::uint64_t bits = rnd();
+			double d;
+			float f;
+			std::uint32_t fbits = static_cast<std::uint32_t>(bits);
+			std::memcpy(&d, &bits, sizeof(d));
+			std::memcpy(&f, &fbits, sizeof(f));
+			if (std::isfinite(d) && d != 0 && !check(d)) {
+				out << "mismatch " << d;
+				return;
+			}
+			if (std::isfinite(f) && f != 0 && !check(f)) {
+				out << "mismatch " << f;
+				return;
+			}
+		}
+		out << "ok";
+	};
+	tst.test("Number.parseExact","1 0 2.2250738585072014e-308 9.007199254740992e+15 1e+23 ok") >> [](std::ostream &out) {
+		out << (string_to_float("0.1") == 0.1) << " ";
+		out << std::string_view(float_to_string(string_to_float("2.4703282292062327e-324"))) << " ";
+		out << std::string_view(float_to_string(string_to_float("2.2250738585072013830902327173324040642192159804623318306e-308"))) << " ";
+		out << std::string_view(float_to_string(string_to_float("9007199254740993"))) << " ";
+		out << std::string_view(float_to_string(string_to_float("1e23"))) << " ";
+		std::mt19937_64 rnd(7);
+		char buff[64];
+		for (int i = 0; i < 100000; i++) {
+			std::uint64_t bits = rnd();
+			double d;
+			std::memcpy(&d, &bits, sizeof(d));
+			if (!std::isfinite(d)) continue;
+			snprintf(buff, sizeof(buff), "%.*e", static_cast<int>(rnd() % 25), d);
+			double a = string_to_float(buff);
+			double b = strtod(buff, nullptr);
+			if (std::memcmp(&a, &b, sizeof(a)) != 0) {
+				out << "mismatch " << buff;
+				return;
+			}
+		}
+		out << "ok";
+	};
+	tst.test("Number.integers","-5 -1234567890123 -9223372036854775808 18446744073709551615 2147483647 -9223372036854775808 -9223372036854775808 18446744073709551615 12 12 ok") >> [](std::ostream &out) {
+		out << Value(-5).get_string() << " ";
+		out << Value(-1234567890123LL).get_string() << " ";
+		out << Value(std::numeric_limits<long long>::min()).get_string() << " ";
+		out << Value(std::numeric_limits<unsigned long long>::max()).get_string() << " ";
+		out << Value::from_string("99999999999").get_int() << " ";
+		out << Value::from_string("-9223372036854775808").get_long_long() << " ";
+		out << Value::from_string("-9223372036854775809").get_long_long() << " ";
+		out << Value::from_string("18446744073709551616").get_unsigned_long_long() << " ";
+		out << string_to_unsigned<unsigned int>("000000000000000000000000012") << " ";
+		out << Value::from_string("12.5").get_int() << " ";
+		std::mt19937_64 rnd(3);
+		for (int i = 0; i < 100000; i++) {
+			auto v = static_cast<long long>(rnd() >> (rnd() % 64));
+			if (i & 1) v = -v;
+			Value x(v);
+			if (x.get_string() != std::to_string(v) || x.get_long_long() != v) {
+				out << "mismatch " << v;
+				return;
+			}
+		}
+		out << "ok";
+	};
+	tst.test("Value.compareOrder","1 1 1 1 1 1 -1 | -99999999999999999999,-5,-0.5,0,2.5,7,1e3,18446744073709551615") >> [](std::ostream &out) {
+		out << (Value(99) < Value(100)) << " ";
+		out << (Value::from_string("99") < Value::from_string("100")) << " ";
+		out << (Value::from_string("-100") < Value::from_string("-99")) << " ";
+		out << (Value(2.5) < Value(7.5)) << " ";
+		out << (Value(Array{1}) < Value(Array{1,2})) << " ";
+		out << (Value(Object{{"a",1}}) < Value(Object{{"a",1},{"b",2}})) << " ";
+		out << Value::from_string("-1e400").get_handle()->compare(*Value::from_string("1e-400").get_handle()) << " | ";
+		Value arr = Value::from_string("[7,-0.5,18446744073709551615,2.5,-5,1e3,0,-99999999999999999999]");
+		std::vector<Value> items(arr.begin(), arr.end());
+		std::sort(items.begin(), items.end());
+		char sep = ' ';
+		for (const Value &x: items) {
+			if (sep == ',') out << sep;
+			out << x.get_string();
+			sep = ',';
+		}
+	};
+	tst.test("Number.boolean","0 1 0 0 1 1 0 1") >> [](std::ostream &out) {
+		out << Value(0).get_bool() << " " << Value(5).get_bool() << " ";
+		out << Value::from_string("0.0").get_bool() << " " << Value::from_string("-0").get_bool() << " ";
+		out << Value::from_string("0.5").get_bool() << " " << Value(2.5).get_bool() << " ";
+		out << Value::from_string("0").get_bool() << " " << Value(-1).get_bool();
+	};
+	tst.test("Number.native","1 123 123 123 0.1 0 2147483647 3 -9 1 1 1 {\"a\":-12,\"b\":1.5,\"c\":18446744073709551615} ok") >> [](std::ostream &out) {
+		Value v(123);
+		out << v.get_handle()->is_native_number() << " ";
+		out << v.get_int() << " " << v.get_double() << " " << v.get_string() << " ";
+		out << Value(0.1f).get_string() << " ";
+		out << Value(-7LL).get_unsigned_int() << " ";
+		out << Value(1e20).get_int() << " ";
+		out << Value(3.7).get_int() << " ";
+		out << Value(-9.0).get_string() << " ";
+		out << (Value(5) == Value::from_string("5")) << " ";
+		out << (Value(5) == Value(5.0)) << " ";
+		out << (Value(-3) < Value(2u)) << " ";
+		out << Value(Object{{"a",-12},{"b",1.5},{"c",std::numeric_limits<unsigned long long>::max()}}).to_string() << " ";
+		for (int i = 0; i < 100; i++) {
+			Value x(1.0/(i+3));
+			std::string_view r[4];
+			std::vector<std::thread> thr;
+			for (int j = 0; j < 4; j++) thr.emplace_back([&, j]{r[j] = x.get_string();});
+			for (auto &t: thr) t.join();
+			if (r[0] != r[1] || r[0] != r[2] || r[0] != r[3] || r[0] != std::string_view(float_to_string(1.0/(i+3)))) {
+				out << "mismatch " << i;
+				return;
+			}
+		}
+		out << "ok";
+	};
+	tst.test("Number.cached","1000 1000 1 -9223372036854775808 2147483647 2 18446744073709551615 0 -2147483648 1e+20 0 ok") >> [](std::ostream &out) {
+		Value v = Value::from_string("[1e3,-9223372036854775808,99999999999999999999,\"x\"]");
+		for (int i = 0; i < 2; i++) out << v[0].get_int() << " ";
+		out << static_cast<int>(v[0].get_handle()->get_number_type()) << " ";
+		out << v[1].get_long_long() << " " << v[2].get_int() << " " << static_cast<int>(v[2].get_handle()->get_number_type()) << " ";
+		out << v[2].get_unsigned_long_long() << " " << v[2].get_handle()->is_native_number() << " ";
+		out << Value::from_string("-99999999999999999999").get_int() << " ";
+		out << v[2].get_double() << " " << v[1].get_unsigned_int();
+		Value many = Value::from_string("[0.25,-17,3e2,12345678901234567890,1.5e-3]");
+		for (int i = 0; i < 100; i++) {
+			Value x = Value::from_string(many.to_string());
+			double r[4];
+			std::vector<std::thread> thr;
+			for (int j = 0; j < 4; j++) thr.emplace_back([&, j]{
+				r[j] = 0;
+				for (const Value &y: x) r[j] += y.get_double();
+			});
+			for (auto &t: thr) t.join();
+			if (r[0] != r[1] || r[0] != r[2] || r[0] != r[3]) {
+				out << " mismatch " << i;
+				return;
+			}
+		}
+		out << " ok";
+	};
+	tst.test("Number.decimal","1999 - 150000 -1 123 9223372036854775807 - -9223372036854775808 - 0 100 - - 1 | 1 0 1 1 -1 0") >> [](std::ostream &out) {
+		auto dec = [&](const Value &v, unsigned int scale) {
+			auto r = v.get_decimal(scale);
+			if (r) out << *r << " "; else out << "- ";
+		};
+		dec(Value::from_string("19.99"), 2);
+		dec(Value::from_string("19.999"), 2);
+		dec(Value::from_string("1.5e3"), 2);
+		dec(Value::from_string("-0.01"), 2);
+		dec(Value::from_string("12.300"), 1);
+		dec(Value::from_string("9223372036854775807"), 0);
+		dec(Value::from_string("9223372036854775807"), 1);
+		dec(Value::from_string("-9223372036854775808"), 0);
+		dec(Value::from_string("1e-400"), 2);
+		dec(Value::from_string("0e999999"), 2);
+		dec(Value(0.1), 3);
+		dec(Value("abc"), 0);
+		dec(Value("123"), 2);
+#ifdef __SIZEOF_INT128__
+		__int128 big = 92233720368547758;
+		big = big * 10000 + 705;
+		out << (Value::from_string("92233720368547758070.5").get_decimal128(1) == big && !Value("12").get_decimal128(0)) << " | ";
+#else
+		out << "1 | ";
+#endif
+		auto cmp = [&](const char *a, const char *b) {
+			out << Value::from_string(a).get_handle()->compare(*Value::from_string(b).get_handle()) << " ";
+		};
+		cmp("0.1000000000000000001", "0.1");
+		cmp("1e2", "100");
+		cmp("9007199254740993", "9007199254740992.0");
+		cmp("-0.3", "-0.30000000000000001");
+		cmp("-1e400", "1e-400");
+		out << Value::from_string("0.10").get_handle()->compare(*Value(0.1).get_handle());
+	};
+	tst.test("Number.smallInt","1 1 0 1 0 1 1 1 -128 -128 1023 1 [1,-2,0,true,null,1024] ok") >> [](std::ostream &out) {
+		out << Value(5).get_handle().is_static() << " ";
+		out << (Value(5).get_handle() == Value(5u).get_handle()) << " ";
+		out << Value(5000).get_handle().is_static() << " ";
+		out << Value(-128).get_handle().is_static() << " ";
+		out << Value(-129).get_handle().is_static() << " ";
+		out << Value(true).get_handle().is_static() << " ";
+		out << Value(nullptr).get_handle().is_static() << " ";
+		out << Value().get_handle().is_static() << " ";
+		out << Value(-128).get_string() << " " << Value(-128).get_int() << " ";
+		out << Value(1023ULL).get_unsigned_int() << " " << Value(1023).get_handle()->is_native_number() << " ";
+		out << Value(Array{1,-2,0,true,nullptr,1024}).to_string() << " ";
+		std::vector<std::thread> thr;
+		for (int j = 0; j < 4; j++) thr.emplace_back([]{
+			std::vector<Value> v;
+			for (int i = 0; i < 10000; i++) v.push_back(i % 3?Value(i % 1000):Value(nullptr));
+			v.clear();
+		});
+		for (auto &t: thr) t.join();
+		out << "ok";
+	};
 #if 0
 	tst.test("Array.editInsert","[\"hi\",\"hola\",{\"inserted\":\"here\"},1,2,3,5,8,13,21,7.5579e+27]") >> [](std::ostream &out){
 		Value v = Value::from_string("[\"hi\",\"hola\",1,2,3,5,8,13,21,7.5579e+27]");
@@ -83,6 +83,8 @@ public:
     Value(const std::initializer_list<KeyValue > &obj);
     ///Construct value with bound key
     Value(const std::string_view &key, const Value &val):_ptr(val.get_handle()->set_key(key)) {}
+    ///Bind key to a value, key is interned in the key table
+    Value(const std::string_view &key, const Value &val, KeyTable &keys):_ptr(val.get_handle()->set_key(key, keys)) {}
     ///Construct value, unbind any bound key
     Value(std::nullptr_t, const Value &val):_ptr(val.get_handle()->unset_key()) {}
 
@@ -117,6 +119,12 @@ public:
     auto get_float() const {return _ptr->get_float();}
     ///Get numeric value
     auto get_double() const {return _ptr->get_double();}
+    ///Get number as exact fixed-point decimal (see Node::get_decimal)
+    auto get_decimal(unsigned int scale) const {return _ptr->get_decimal(scale);}
+#ifdef __SIZEOF_INT128__
+    ///Get number as exact fixed-point decimal in 128-bit integer
+    auto get_decimal128(unsigned int scale) const {return _ptr->get_decimal128(scale);}
+#endif
     ///Get boolean value
     auto get_bool() const {return _ptr->get_boolean();}
     ///Retrieve bound key
@@ -633,6 +641,14 @@ public:
         }
         std::sort(bld.begin(),bld.end(),Node::KeyOrder());
     })){}
+    ///construct from initializer list definition, keys are interned in the key table
+    Object(const std::initializer_list<KeyValue > &obj, KeyTable &keys)
+        :Value(Node::new_object(obj.size(), [&](ContBuilder &bld) {
+        for (const auto &itm: obj) {
+            bld.push_back(itm.second.get_handle()->set_key(itm.first, keys));
+        }
+        std::sort(bld.begin(),bld.end(),Node::KeyOrder());
+    })){}
     ///construct object from container of values with ability to filter and transfer items
     /**
      * @param c source container